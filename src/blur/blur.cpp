@@ -17,6 +17,7 @@
 #include "wayland/surface_interface.h"
 
 #include <QGuiApplication>
+#include <QLoggingCategory>
 #include <QMatrix4x4>
 #include <QScreen>
 #include <QTime>
@@ -30,6 +31,8 @@
 
 #include <KDecoration2/Decoration>
 
+Q_LOGGING_CATEGORY(LIGHTLYSHADERS_BLUR, "kwin_effect_lightlyshaders_blur", QtWarningMsg)
+
 namespace KWin
 {
 
@@ -40,7 +43,8 @@ QTimer *BlurEffect::s_blurManagerRemoveTimer = nullptr;
 
 BlurEffect::BlurEffect()
 {
-    m_helper = new LSHelper();
+    m_loadTimer.start();
+    m_helper = LSHelper::instance();
 
     initConfig<BlurConfig>();
     m_shader = new BlurShader(this);
@@ -50,7 +54,7 @@ BlurEffect::BlurEffect()
 
     // ### Hackish way to announce support.
     //     Should be included in _NET_SUPPORTED instead.
-    if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
+    if (m_shader && (m_shader->isValid() || m_shader->isBuilding()) && m_renderTargetsValid) {
         if (effects->xcbConnection()) {
             net_wm_blur_region = effects->announceSupportProperty(s_blurAtomName, this);
         }
@@ -71,12 +75,11 @@ BlurEffect::BlurEffect()
     }
 
     connect(effects, &EffectsHandler::windowAdded, this, &BlurEffect::slotWindowAdded);
-    connect(effects, &EffectsHandler::windowDeleted, this, &BlurEffect::slotWindowDeleted);
     connect(effects, &EffectsHandler::windowDecorationChanged, this, &BlurEffect::setupDecorationConnections);
     connect(effects, &EffectsHandler::propertyNotify, this, &BlurEffect::slotPropertyNotify);
     connect(effects, &EffectsHandler::virtualScreenGeometryChanged, this, &BlurEffect::slotScreenGeometryChanged);
     connect(effects, &EffectsHandler::xcbConnectionChanged, this, [this]() {
-        if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
+        if (m_shader && (m_shader->isValid() || m_shader->isBuilding()) && m_renderTargetsValid) {
             net_wm_blur_region = effects->announceSupportProperty(s_blurAtomName, this);
         }
     });
@@ -270,17 +273,33 @@ void BlurEffect::reconfigure(ReconfigureFlags flags)
     BlurConfig::self()->read();
 
     int blurStrength = BlurConfig::blurStrength() - 1;
-    m_downSampleIterations = blurStrengthValues[blurStrength].iteration;
-    m_offset = blurStrengthValues[blurStrength].offset;
+    const int downSampleIterations = blurStrengthValues[blurStrength].iteration;
+    const int offset = blurStrengthValues[blurStrength].offset;
+    const int noiseStrength = BlurConfig::noiseStrength();
+    const int scalingFactor = std::max(1.0, QGuiApplication::primaryScreen()->logicalDotsPerInch() / 96.0);
+
+    // Only the number of downsample passes needs new render targets, the
+    // offset is a uniform and the noise texture is built on its own
+    const bool chainChanged = m_renderTargets.isEmpty() || downSampleIterations != m_downSampleIterations;
+    const bool noiseChanged = noiseStrength != m_noiseStrength || scalingFactor != m_scalingFactor;
+    const bool offsetChanged = offset != m_offset;
+
+    m_downSampleIterations = downSampleIterations;
+    m_offset = offset;
     m_expandSize = blurOffsets[m_downSampleIterations - 1].expandSize;
-    m_noiseStrength = BlurConfig::noiseStrength();
-
-    m_scalingFactor = std::max(1.0, QGuiApplication::primaryScreen()->logicalDotsPerInch() / 96.0);
+    m_noiseStrength = noiseStrength;
+    m_scalingFactor = scalingFactor;
 
-    updateTexture();
+    if (chainChanged) {
+        updateTexture();
+    } else if (noiseChanged) {
+        m_noiseTexture.reset();
+    }
 
     // Update all windows for the blur to take effect
-    effects->addRepaintFull();
+    if (chainChanged || noiseChanged || offsetChanged) {
+        effects->addRepaintFull();
+    }
 
     m_helper->reconfigure();
 }
@@ -320,19 +339,25 @@ void BlurEffect::updateBlurRegion(EffectWindow *w)
         }
     }
 
-    if (valid) {
-        blurRegions[w] = region;
-    } else {
-        blurRegions.remove(w);
+    // Property changes may still arrive for a window that is gone
+    LSWindowRecord *record = m_helper->findWindow(w);
+    if (!record) {
+        return;
     }
+    record->hasBlurRegion = valid;
+    record->shapes->blurRegion = valid ? region : QRegion();
+    record->blurShapeValid = false;
 }
 
 void BlurEffect::slotWindowAdded(EffectWindow *w)
 {
+    // Registers the window and checks if it needs rounding corners
+    LSWindowRecord &record = m_helper->addWindow(w);
+
     KWaylandServer::SurfaceInterface *surf = w->surface();
 
     if (surf) {
-        windowBlurChangedConnections[w] = connect(surf, &KWaylandServer::SurfaceInterface::blurChanged, this, [this, w]() {
+        record.shapes->blurChangedConnection = connect(surf, &KWaylandServer::SurfaceInterface::blurChanged, this, [this, w]() {
             if (w) {
                 updateBlurRegion(w);
             }
@@ -344,23 +369,6 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
     setupDecorationConnections(w);
     updateBlurRegion(w);
-
-    // Check if window needs rounding corners
-    m_helper->blurWindowAdded(w);
-}
-
-void BlurEffect::slotWindowDeleted(EffectWindow *w)
-{
-    blurRegions.remove(w);
-    auto it = windowBlurChangedConnections.find(w);
-    if (it == windowBlurChangedConnections.end()) {
-        return;
-    }
-    disconnect(*it);
-    windowBlurChangedConnections.erase(it);
-
-    // remove window
-    m_helper->blurWindowDeleted(w);
 }
 
 void BlurEffect::slotPropertyNotify(EffectWindow *w, long atom)
@@ -468,8 +476,8 @@ QRegion BlurEffect::blurRegion(EffectWindow *w) const
 {
     QRegion region;
 
-    if (auto it = blurRegions.find(w); it != blurRegions.end()) {
-        const QRegion &appRegion = *it;
+    if (const LSWindowRecord *record = m_helper->findWindow(w); record && record->hasBlurRegion) {
+        const QRegion &appRegion = record->shapes->blurRegion;
         if (!appRegion.isEmpty()) {
             if (w->decorationHasAlpha() && decorationSupportsBlurBehind(w)) {
                 region = decorationBlurRegion(w);
@@ -547,9 +555,41 @@ void BlurEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseco
     m_paintedArea = QRegion();
     m_currentBlur = QRegion();
 
+    // Programs built since the last frame are used from this one on,
+    // before the frame makes the context current
+    if (m_shader->isBuilding()) {
+        effects->makeOpenGLContextCurrent();
+        m_shader->poll();
+    }
+
     effects->prePaintScreen(data, presentTime);
 }
 
+void BlurEffect::postPaintScreen()
+{
+    effects->postPaintScreen();
+
+    // Windows painted without blur are painted again once it's built
+    const bool building = m_shader->isBuilding();
+    if (building) {
+        effects->addRepaintFull();
+    }
+
+    // How long after the constructor the first frame was painted, and the
+    // first one with the shader built
+    if (m_loadTimer.isValid()) {
+        const qreal elapsed = m_loadTimer.nsecsElapsed() / 1e6;
+        if (!m_firstFramePainted) {
+            m_firstFramePainted = true;
+            qCDebug(LIGHTLYSHADERS_BLUR) << "First frame" << elapsed << "ms after loading, shaders building:" << building;
+        }
+        if (!building) {
+            qCDebug(LIGHTLYSHADERS_BLUR) << "Shaders built" << elapsed << "ms after loading, valid:" << m_shader->isValid();
+            m_loadTimer.invalidate();
+        }
+    }
+}
+
 void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     // this effect relies on prePaintWindow being called in the bottom to top order
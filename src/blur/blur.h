@@ -11,6 +11,7 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QElapsedTimer>
 #include <QStack>
 #include <QVector2D>
 #include <QVector>
@@ -42,6 +43,7 @@ public:
 
     void reconfigure(ReconfigureFlags flags) override;
     void prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime) override;
+    void postPaintScreen() override;
     void prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime) override;
     void drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) override;
 
@@ -59,7 +61,6 @@ public:
 
 public Q_SLOTS:
     void slotWindowAdded(KWin::EffectWindow *w);
-    void slotWindowDeleted(KWin::EffectWindow *w);
     void slotPropertyNotify(KWin::EffectWindow *w, long atom);
     void slotScreenGeometryChanged();
     void setupDecorationConnections(EffectWindow *w);
@@ -88,9 +89,12 @@ private:
     void copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount, QRegion blurShape, const QMatrix4x4 &screenProjection);
 
 private:
-    LSHelper *m_helper;
+    QSharedPointer<LSHelper> m_helper;
 
     BlurShader *m_shader;
+    // Runs from the constructor until the shader is built
+    QElapsedTimer m_loadTimer;
+    bool m_firstFramePainted = false;
     QVector<GLFramebuffer *> m_renderTargets;
     QVector<GLTexture *> m_renderTextures;
     QStack<GLFramebuffer *> m_renderTargetStack;
@@ -102,11 +106,11 @@ private:
     QRegion m_paintedArea; // keeps track of all painted areas (from bottom to top)
     QRegion m_currentBlur; // keeps track of the currently blured area of the windows(from bottom to top)
 
-    int m_downSampleIterations; // number of times the texture will be downsized to half size
-    int m_offset;
-    int m_expandSize;
-    int m_noiseStrength;
-    int m_scalingFactor;
+    int m_downSampleIterations = 0; // number of times the texture will be downsized to half size
+    int m_offset = 0;
+    int m_expandSize = 0;
+    int m_noiseStrength = 0;
+    int m_scalingFactor = 0;
 
     struct OffsetStruct
     {
@@ -125,9 +129,6 @@ private:
 
     QVector<BlurValuesStruct> blurStrengthValues;
 
-    QMap<EffectWindow *, QMetaObject::Connection> windowBlurChangedConnections;
-    QMap<const EffectWindow *, QRegion> blurRegions;
-
     static KWaylandServer::BlurManagerInterface *s_blurManager;
     static QTimer *s_blurManagerRemoveTimer;
 };
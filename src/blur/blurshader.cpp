@@ -23,26 +23,73 @@ BlurShader::BlurShader(QObject *parent)
 {
     ensureResources();
 
-    m_shaderDownsample = ShaderManager::instance()->generateShaderFromFile(
+    m_builds[DownSampleType] = std::make_unique<LSProgramBuild>(
         ShaderTrait::MapTexture,
         QStringLiteral(":/effects/blur/shaders/vertex.vert"),
         QStringLiteral(":/effects/blur/shaders/downsample.frag"));
 
-    m_shaderUpsample = ShaderManager::instance()->generateShaderFromFile(
+    m_builds[UpSampleType] = std::make_unique<LSProgramBuild>(
         ShaderTrait::MapTexture,
         QStringLiteral(":/effects/blur/shaders/vertex.vert"),
         QStringLiteral(":/effects/blur/shaders/upsample.frag"));
 
-    m_shaderCopysample = ShaderManager::instance()->generateShaderFromFile(
+    m_builds[CopySampleType] = std::make_unique<LSProgramBuild>(
         ShaderTrait::MapTexture,
         QStringLiteral(":/effects/blur/shaders/vertex.vert"),
         QStringLiteral(":/effects/blur/shaders/copy.frag"));
 
-    m_shaderNoisesample = ShaderManager::instance()->generateShaderFromFile(
+    m_builds[NoiseSampleType] = std::make_unique<LSProgramBuild>(
         ShaderTrait::MapTexture,
         QStringLiteral(":/effects/blur/shaders/vertex.vert"),
         QStringLiteral(":/effects/blur/shaders/noise.frag"));
+}
+
+BlurShader::~BlurShader()
+{
+}
+
+bool BlurShader::isBuilding() const
+{
+    for (const auto &build : m_builds) {
+        if (build) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BlurShader::poll()
+{
+    if (!isBuilding()) {
+        return;
+    }
 
+    std::unique_ptr<GLShader> *shaders[] = {&m_shaderDownsample, &m_shaderUpsample, &m_shaderCopysample, &m_shaderNoisesample};
+
+    // Without parallel compiling only one program is built per call
+    bool compiled = false;
+    for (int i = 0; i < 4; ++i) {
+        std::unique_ptr<LSProgramBuild> &build = m_builds[i];
+        if (!build) {
+            continue;
+        }
+        if (!build->isReady()) {
+            if (build->isParallel() || compiled) {
+                continue;
+            }
+            compiled = true;
+        }
+        *shaders[i] = build->finish();
+        build.reset();
+    }
+
+    if (!isBuilding()) {
+        init();
+    }
+}
+
+void BlurShader::init()
+{
     m_valid = m_shaderDownsample->isValid() && m_shaderUpsample->isValid() && m_shaderCopysample->isValid() && m_shaderNoisesample->isValid();
 
     if (m_valid) {
@@ -104,10 +151,6 @@ BlurShader::BlurShader(QObject *parent)
     }
 }
 
-BlurShader::~BlurShader()
-{
-}
-
 void BlurShader::setModelViewProjectionMatrix(const QMatrix4x4 &matrix)
 {
     if (!isValid()) {
@@ -9,6 +9,8 @@
 
 #include <kwinglutils.h>
 
+#include "lsprogrambuild.h"
+
 #include <QMatrix4x4>
 #include <QObject>
 #include <QVector2D>
@@ -17,6 +19,10 @@
 namespace KWin
 {
 
+/*
+ * The programs are built in the background where the driver can, see
+ * LSProgramBuild, and the shader is invalid until poll() finished them.
+ */
 class BlurShader : public QObject
 {
     Q_OBJECT
@@ -26,6 +32,9 @@ public:
     ~BlurShader() override;
 
     bool isValid() const;
+    // Finishes the programs that are built, call once per frame
+    void poll();
+    bool isBuilding() const;
 
     enum SampleType {
         DownSampleType,
@@ -45,6 +54,9 @@ public:
     void setBlurRect(const QRect &blurRect, const QSize &screenSize);
 
 private:
+    void init();
+
+    std::unique_ptr<LSProgramBuild> m_builds[4];
     std::unique_ptr<GLShader> m_shaderDownsample;
     std::unique_ptr<GLShader> m_shaderUpsample;
     std::unique_ptr<GLShader> m_shaderCopysample;
@@ -0,0 +1,75 @@
+#include "lsconfig.h"
+#include "lightlyshaders_config.h"
+
+namespace KWin {
+
+LSConfig
+LSConfig::load()
+{
+    LightlyShadersConfig::self()->load();
+
+    LSConfig config;
+    config.roundness = LightlyShadersConfig::roundness();
+    config.cornersType = LightlyShadersConfig::cornersType();
+    config.squircleRatio = LightlyShadersConfig::squircleRatio();
+    config.shadowOffset = LightlyShadersConfig::shadowOffset();
+
+    config.innerOutline = LightlyShadersConfig::innerOutline();
+    config.innerOutlineWidth = LightlyShadersConfig::innerOutlineWidth();
+    config.innerOutlineColor = LightlyShadersConfig::innerOutlineColor();
+    config.outerOutline = LightlyShadersConfig::outerOutline();
+    config.outerOutlineWidth = LightlyShadersConfig::outerOutlineWidth();
+    config.outerOutlineColor = LightlyShadersConfig::outerOutlineColor();
+
+    config.disabledForMaximized = LightlyShadersConfig::disabledForMaximized();
+    config.renderMode = LightlyShadersConfig::renderMode();
+    config.offscreenIdleFrames = LightlyShadersConfig::offscreenIdleFrames();
+    config.offscreenBudget = LightlyShadersConfig::offscreenBudget();
+    config.excludedWindowClasses = LightlyShadersConfig::excludedWindowClasses();
+    return config;
+}
+
+LSConfig::Changes
+LSConfig::diff(const LSConfig &previous) const
+{
+    Changes changes = NoChange;
+
+    if (roundness != previous.roundness
+            || cornersType != previous.cornersType
+            || squircleRatio != previous.squircleRatio
+            || shadowOffset != previous.shadowOffset)
+        changes |= GeometryChanged;
+
+    if (innerOutline != previous.innerOutline
+            || innerOutlineWidth != previous.innerOutlineWidth
+            || innerOutlineColor != previous.innerOutlineColor
+            || outerOutline != previous.outerOutline
+            || outerOutlineWidth != previous.outerOutlineWidth
+            || outerOutlineColor != previous.outerOutlineColor)
+        changes |= OutlineChanged;
+
+    if (excludedWindowClasses != previous.excludedWindowClasses)
+        changes |= ClassificationChanged;
+
+    if (disabledForMaximized != previous.disabledForMaximized)
+        changes |= MaximizedChanged;
+
+    if (renderMode != previous.renderMode)
+        changes |= RenderModeChanged;
+
+    if (offscreenIdleFrames != previous.offscreenIdleFrames
+            || offscreenBudget != previous.offscreenBudget)
+        changes |= OffscreenLimitsChanged;
+
+    return changes;
+}
+
+int
+LSConfig::cornerSize() const
+{
+    if (cornersType == LightlyShadersConfig::EnumCornersType::SquircledCorners)
+        return roundness * 0.5 * squircleRatio;
+    return roundness;
+}
+
+} // namespace KWin
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "liblshelper_export.h"
+
+#include <QColor>
+#include <QFlags>
+#include <QStringList>
+
+namespace KWin {
+
+/*
+ * An immutable copy of the LightlyShaders settings. Comparing two of them
+ * tells which parts of the effect need rebuilding after a reconfigure.
+ */
+class LIBLSHELPER_EXPORT LSConfig
+{
+public:
+    enum Change {
+        NoChange = 0,
+        GeometryChanged = 1 << 0,       // Corner size, shape or shadow offset
+        OutlineChanged = 1 << 1,        // Outline colors and widths
+        ClassificationChanged = 1 << 2, // Window class exclusions
+        MaximizedChanged = 1 << 3,      // Rounding of maximized windows
+        RenderModeChanged = 1 << 4,     // Offscreen or corners only
+        OffscreenLimitsChanged = 1 << 5, // When offscreen textures are released
+        AllChanged = GeometryChanged | OutlineChanged | ClassificationChanged | MaximizedChanged | RenderModeChanged | OffscreenLimitsChanged
+    };
+    Q_DECLARE_FLAGS(Changes, Change)
+
+    // Reads the settings from disk
+    static LSConfig load();
+
+    Changes diff(const LSConfig &previous) const;
+
+    // Corner size in logical pixels, squircles are larger than circles
+    // for the same roundness
+    int cornerSize() const;
+
+    int roundness = 0;
+    int cornersType = 0;
+    int squircleRatio = 0;
+    int shadowOffset = 0;
+
+    bool innerOutline = false;
+    int innerOutlineWidth = 0;
+    QColor innerOutlineColor;
+    bool outerOutline = false;
+    int outerOutlineWidth = 0;
+    QColor outerOutlineColor;
+
+    bool disabledForMaximized = false;
+    int renderMode = 0;
+    int offscreenIdleFrames = 0;
+    int offscreenBudget = 0; // MiB, 0 for no limit
+    QStringList excludedWindowClasses;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(LSConfig::Changes)
+
+} // namespace KWin
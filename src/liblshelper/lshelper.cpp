@@ -1,51 +1,125 @@
 #include "lshelper.h"
-#include "lightlyshaders_config.h"
 
-#include <QBitmap>
-#include <QPainter>
-#include <QPainterPath>
+#include <QtConcurrent>
+#include <QRegularExpression>
 #include <QtMath>
 
 Q_LOGGING_CATEGORY(LSHELPER, "liblshelper", QtWarningMsg)
 
 namespace KWin {
 
+// Captions of JetBrains helper windows, like "win0"
+static const QRegularExpression s_generatedCaption(QStringLiteral("win[0-9]+"));
+
+// Enough for every output scale in use plus the previous configuration
+static const int s_maskCacheSize = 8;
+
+bool
+LSHelper::MaskKey::operator==(const MaskKey &other) const
+{
+    return radius == other.radius
+        && qFuzzyCompare(scale, other.scale)
+        && cornersType == other.cornersType
+        && squircleRatio == other.squircleRatio
+        && shadowOffset == other.shadowOffset;
+}
+
+QSharedPointer<LSHelper>
+LSHelper::instance()
+{
+    static QWeakPointer<LSHelper> s_instance;
+
+    QSharedPointer<LSHelper> helper = s_instance.toStrongRef();
+    if (!helper) {
+        helper.reset(new LSHelper());
+        s_instance = helper;
+    }
+    return helper;
+}
+
 LSHelper::LSHelper() : QObject()
 {
-    for (int i = 0; i < NTex; ++i)
-    {
-        m_maskRegions[i] = 0;
+    reconfigure();
+
+    // Connected before any effect connects its own slots, so effects see
+    // the record of a new window and no longer see it once it's deleted
+    const auto stackingOrder = effects->stackingOrder();
+    for (EffectWindow *window : stackingOrder) {
+        addWindow(window);
     }
+    connect(effects, &EffectsHandler::windowAdded, this, [this](EffectWindow *w) {
+        addWindow(w);
+    });
+    connect(effects, &EffectsHandler::windowDeleted, this, &LSHelper::removeWindow);
+
+    // KWin 5.27 tells effects nothing about class or caption changes. A
+    // window is classified when added and again when it's shown or its
+    // decoration changes, so painting only reads the verdict.
+    connect(effects, &EffectsHandler::windowShown, this, &LSHelper::classifyWindow);
+    connect(effects, &EffectsHandler::windowDecorationChanged, this, &LSHelper::classifyWindow);
+
+    connect(effects, &EffectsHandler::windowFrameGeometryChanged, this, [this](EffectWindow *w) {
+        invalidateBlurShape(w);
+        if (LSWindowRecord *record = m_windows.find(w)) {
+            record->geometryValid = false;
+        }
+    });
+    connect(effects, &EffectsHandler::windowMaximizedStateChanged, this, [this](EffectWindow *w) {
+        invalidateBlurShape(w);
+    });
 }
 
 LSHelper::~LSHelper()
 {
-    //delete mask regions
-    for (int i = 0; i < NTex; ++i)
-    {
-        if (m_maskRegions[i])
-            delete m_maskRegions[i];
+    // Mask sets still being created would be delivered to a deleted helper
+    for (QFutureWatcher<MaskSet> *watcher : qAsConst(m_maskWatchers)) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
     }
-
-    m_managed.clear();
+    m_maskCache.clear();
+    m_windows.clear();
 }
 
 void
 LSHelper::reconfigure()
 {
-    LightlyShadersConfig::self()->load();
+    // Every effect sharing the helper reconfigures it. Reading the file
+    // again is cheap, the diff leaves nothing to rebuild for the others.
+    const LSConfig config = LSConfig::load();
+    const LSConfig::Changes changes = m_configured ? config.diff(m_config) : LSConfig::AllChanged;
+    if (changes == LSConfig::NoChange) {
+        return;
+    }
+    m_configured = true;
+    m_config = config;
 
-    m_cornersType = LightlyShadersConfig::cornersType();
-    m_squircleRatio = LightlyShadersConfig::squircleRatio();
-    m_shadowOffset = LightlyShadersConfig::shadowOffset();
-    m_size = LightlyShadersConfig::roundness();
-    m_disabledForMaximized = LightlyShadersConfig::disabledForMaximized();
+    m_cornersType = config.cornersType;
+    m_squircleRatio = config.squircleRatio;
+    m_shadowOffset = config.shadowOffset;
+    m_disabledForMaximized = config.disabledForMaximized;
+    m_size = config.cornerSize();
 
-    if(m_cornersType == SquircledCorners) {
-        m_size = m_size * 0.5 * m_squircleRatio;
+    if (changes & LSConfig::GeometryChanged) {
+        setMaskRegions();
     }
+    if (changes & LSConfig::ClassificationChanged) {
+        compileRules();
+        m_windows.forEach([this](LSWindowRecord &record) {
+            record.isManaged = isManagedWindow(record.window);
+        });
+    }
+    if (changes & (LSConfig::GeometryChanged | LSConfig::ClassificationChanged | LSConfig::MaximizedChanged)) {
+        m_windows.forEach([](LSWindowRecord &record) {
+            record.blurShapeValid = false;
+            record.geometryValid = false;
+        });
+    }
+}
 
-    setMaskRegions();
+const LSConfig &
+LSHelper::config() const
+{
+    return m_config;
 }
 
 int
@@ -57,39 +131,242 @@ LSHelper::roundness()
 void
 LSHelper::setMaskRegions()
 {
-    int size = m_size + m_shadowOffset;
-    QImage img = genMaskImg(size, true, false);
+    // Rasterize the masks of every output at its own scale up front
+    const auto screens = effects->screens();
+    for (EffectScreen *s : screens) {
+        maskSet(s);
+    }
+}
+
+LSHelper::MaskKey
+LSHelper::maskKey(qreal scale) const
+{
+    return MaskKey{m_size, scale, m_cornersType, m_squircleRatio, m_shadowOffset};
+}
+
+LSHelper::MaskSet
+LSHelper::maskSet(qreal scale)
+{
+    const MaskKey key = maskKey(scale);
+
+    for (int i = 0; i < m_maskCache.size(); ++i) {
+        if (m_maskCache.at(i).key == key) {
+            // Keep the most recently used set in front
+            if (i > 0) {
+                m_maskCache.move(i, 0);
+            }
+            return m_maskCache.constFirst();
+        }
+    }
+
+    // Without any set to fall back on there is nothing to draw with
+    if (m_maskCache.isEmpty()) {
+        m_maskCache.prepend(createMaskSet(key));
+        return m_maskCache.constFirst();
+    }
+
+    requestMaskSet(key);
+
+    // Keep drawing with the previous set of this scale, or else the most
+    // recent one, its logical regions are close enough for a few frames
+    for (const MaskSet &set : qAsConst(m_maskCache)) {
+        if (qFuzzyCompare(set.key.scale, scale)) {
+            return set;
+        }
+    }
+    return m_maskCache.constFirst();
+}
+
+void
+LSHelper::requestMaskSet(const MaskKey &key)
+{
+    if (m_pendingMasks.contains(key)) {
+        return;
+    }
+    m_pendingMasks.append(key);
+
+    // createMaskSet() only works on its arguments, so it can run on the
+    // thread pool while the compositor keeps painting
+    auto watcher = new QFutureWatcher<MaskSet>(this);
+    m_maskWatchers.append(watcher);
+    connect(watcher, &QFutureWatcher<MaskSet>::finished, this, [this, watcher, key]() {
+        m_pendingMasks.removeOne(key);
+        m_maskWatchers.removeOne(watcher);
+
+        if (m_maskCache.size() >= s_maskCacheSize) {
+            m_maskCache.removeLast();
+        }
+        m_maskCache.prepend(watcher->result());
+        watcher->deleteLater();
+
+        m_windows.forEach([](LSWindowRecord &record) {
+            record.blurShapeValid = false;
+            record.geometryValid = false;
+        });
+        effects->addRepaintFull();
+    });
+    watcher->setFuture(QtConcurrent::run(&LSHelper::createMaskSet, key));
+}
+
+LSHelper::MaskSet
+LSHelper::maskSet(EffectScreen *screen)
+{
+    return maskSet(screen ? screen->devicePixelRatio() : 1.0);
+}
+
+LSHelper::MaskSet
+LSHelper::createMaskSet(const MaskKey &key)
+{
+    MaskSet set;
+    set.key = key;
+
+    const int radius = qRound(key.radius * key.scale);
+    set.size = radius + qRound(key.shadowOffset * key.scale);
+
+    const QVector<int> spans = cornerSpans(set.size, radius, key.cornersType, key.squircleRatio);
+    const QVector<int> translucent = translucentSpans(key.radius, key.scale, key.cornersType, key.squircleRatio);
+    for (int corner = 0; corner < NTex; ++corner) {
+        set.regions[corner] = createMaskRegion(spans, set.size, corner);
+        set.logicalRegions[corner] = toLogicalRegion(set.regions[corner], key.scale);
+        set.translucentRegions[corner] = createMaskRegion(translucent, key.radius, corner);
+    }
+
+    return set;
+}
+
+/*
+ * For every row of the top left corner tile returns how many pixels,
+ * counted from the left edge, lie completely outside of the corner curve.
+ * The curve is centered at (size, size), so the pixel nearest to it is
+ * its bottom right point, and the row is covered up to where the circle
+ * or superellipse equation crosses that point's row.
+ */
+QVector<int>
+LSHelper::cornerSpans(int size, int radius, int cornersType, int squircleRatio)
+{
+    QVector<int> spans(size);
+
+    const double r = radius;
+    const double n = (cornersType == SquircledCorners) ? squircleRatio : 2.0;
+    const double rn = (cornersType == SquircledCorners) ? qPow(r, n) : r * r;
+
+    for (int row = 0; row < size; ++row) {
+        const double dy = size - row - 1;
+        if (dy >= r) {
+            spans[row] = size;
+            continue;
+        }
+
+        double t;
+        if (cornersType == SquircledCorners) {
+            t = qPow(rn - qPow(dy, n), 1.0 / n);
+        } else {
+            t = qSqrt(rn - dy * dy);
+        }
+
+        // A pixel only touching the curve is not covered by it
+        spans[row] = qBound(0, size - qCeil(t - 1e-6), size);
+    }
+
+    return spans;
+}
+
+/*
+ * For every logical row of a radius sized tile at the top left frame
+ * corner returns how many pixels, counted from the left edge, are not
+ * painted fully opaque. The shader blends device pixels whose center is
+ * less than half a pixel inside the curve, so a logical pixel only counts
+ * as opaque when its outer corner lies a whole device pixel inside it,
+ * which also covers rounding the opaque region to device pixels.
+ */
+QVector<int>
+LSHelper::translucentSpans(int radius, qreal scale, int cornersType, int squircleRatio)
+{
+    QVector<int> spans(qMax(radius, 0));
+
+    const double n = (cornersType == SquircledCorners) ? squircleRatio : 2.0;
+    const double opaque = radius * scale - 1.0;
+
+    for (int row = 0; row < radius; ++row) {
+        const double dy = (radius - row) * scale;
+        if (dy > opaque) {
+            spans[row] = radius;
+            continue;
+        }
+
+        double t;
+        if (cornersType == SquircledCorners) {
+            t = qPow(qPow(opaque, n) - qPow(dy, n), 1.0 / n);
+        } else {
+            t = qSqrt(opaque * opaque - dy * dy);
+        }
+
+        spans[row] = qBound(0, qCeil(radius - t / scale - 1e-6), radius);
+    }
+
+    return spans;
+}
+
+QRegion
+LSHelper::createMaskRegion(const QVector<int> &spans, int size, int corner)
+{
+    const bool mirrorX = (corner == TopRight || corner == BottomRight);
+    const bool mirrorY = (corner == BottomRight || corner == BottomLeft);
+
+    QVector<QRect> rects;
+    rects.reserve(size);
+
+    for (int y = 0; y < size; ++y) {
+        const int width = spans[mirrorY ? size - 1 - y : y];
+        if (width <= 0) {
+            continue;
+        }
+        const int x = mirrorX ? size - width : 0;
+
+        // Coalesce equal spans of adjacent rows into one band
+        if (!rects.isEmpty()) {
+            QRect &last = rects.last();
+            if (last.x() == x && last.width() == width && last.bottom() + 1 == y) {
+                last.setBottom(y);
+                continue;
+            }
+        }
+        rects.append(QRect(x, y, width, 1));
+    }
 
-    m_maskRegions[TopLeft] = createMaskRegion(img, size, TopLeft);
-    m_maskRegions[TopRight] = createMaskRegion(img, size, TopRight);
-    m_maskRegions[BottomRight] = createMaskRegion(img, size, BottomRight);
-    m_maskRegions[BottomLeft] = createMaskRegion(img, size, BottomLeft);
+    QRegion region;
+    region.setRects(rects.constData(), rects.size());
+    return region;
+}
+
+static uint
+regionHash(const QRegion &region)
+{
+    uint hash = region.rectCount();
+    for (const QRect &r : region) {
+        hash = ((((hash * 31) + r.x()) * 31 + r.y()) * 31 + r.width()) * 31 + r.height();
+    }
+    return hash;
 }
 
-QRegion *
-LSHelper::createMaskRegion(QImage img, int size, int corner)
+/*
+ * Maps a device pixel mask back to logical pixels. Partially covered
+ * logical pixels are kept, so the result never misses a device pixel.
+ */
+QRegion
+LSHelper::toLogicalRegion(const QRegion &region, qreal scale)
 {
-    QImage img_copy;
-
-    switch(corner) {
-        case TopLeft:
-            img_copy = img.copy(0, 0, size, size);
-            break;
-        case TopRight:
-            img_copy = img.copy(size, 0, size, size);
-            break;
-        case BottomRight:
-            img_copy = img.copy(size, size, size, size);
-            break;
-        case BottomLeft:
-            img_copy = img.copy(0, size, size, size);
-            break;
-    }
-
-    img_copy = img_copy.createMaskFromColor(QColor(Qt::black).rgb(), Qt::MaskOutColor);
-    QBitmap bitmap = QBitmap::fromImage(img_copy, Qt::DiffuseAlphaDither);
-
-    return new QRegion(bitmap);
+    if (qFuzzyCompare(scale, 1.0)) {
+        return region;
+    }
+
+    QRegion logical;
+    for (const QRect &r : region) {
+        const QPoint topLeft(qFloor(r.x() / scale), qFloor(r.y() / scale));
+        const QPoint bottomRight(qCeil((r.x() + r.width()) / scale) - 1, qCeil((r.y() + r.height()) / scale) - 1);
+        logical += QRect(topLeft, bottomRight);
+    }
+    return logical;
 }
 
 void 
@@ -99,33 +376,62 @@ LSHelper::roundBlurRegion(EffectWindow *w, QRegion *blur_region)
         return;
     }
 
-    if(!m_managed.contains(w)) {
+    LSWindowRecord *record = m_windows.find(w);
+    if(!record) {
+        return;
+    }
+    if(!record->isManaged || w->isFullScreen()) {
         return;
     }
 
     const QRectF geo(w->frameGeometry());
+    const uint hash = regionHash(*blur_region);
+
+    // Maximizing and geometry changes invalidate the shape, see the constructor
+    if (record->blurShapeValid
+            && record->blurShapeFrameSize == geo.size()
+            && record->blurShapeHash == hash
+            && record->shapes->blurShapeRegion == *blur_region) {
+        *blur_region = record->shapes->blurShape;
+        return;
+    }
+
+    record->blurShapeValid = true;
+    record->blurShapeFrameSize = geo.size();
+    record->blurShapeHash = hash;
+    record->shapes->blurShapeRegion = *blur_region;
 
     QRectF maximized_area = effects->clientArea(MaximizeArea, w);
     if (maximized_area == geo && m_disabledForMaximized) {
+        record->shapes->blurShape = *blur_region;
         return;
     }
 
-	QRegion top_left = *m_maskRegions[TopLeft];
-    top_left.translate(0-m_shadowOffset+1, 0-m_shadowOffset+1);  
+    const MaskSet masks = maskSet(w->screen());
+
+    // Offsets of the set in use, which lags behind a config change while
+    // the new set is being built
+    const int size = masks.key.radius;
+    const int shadowOffset = masks.key.shadowOffset;
+
+	QRegion top_left = masks.logicalRegions[TopLeft];
+    top_left.translate(0-shadowOffset+1, 0-shadowOffset+1);  
     *blur_region = blur_region->subtracted(top_left);  
     
-    QRegion top_right = *m_maskRegions[TopRight];
-    top_right.translate(geo.width() - m_size-1, 0-m_shadowOffset+1);   
+    QRegion top_right = masks.logicalRegions[TopRight];
+    top_right.translate(geo.width() - size-1, 0-shadowOffset+1);   
     *blur_region = blur_region->subtracted(top_right);  
 
-    QRegion bottom_right = *m_maskRegions[BottomRight];
-    bottom_right.translate(geo.width() - m_size-1, geo.height()-m_size-1);    
+    QRegion bottom_right = masks.logicalRegions[BottomRight];
+    bottom_right.translate(geo.width() - size-1, geo.height()-size-1);    
     *blur_region = blur_region->subtracted(bottom_right);     
     
-    QRegion bottom_left = *m_maskRegions[BottomLeft];
-    bottom_left.translate(0-m_shadowOffset+1, geo.height()-m_size-1);
+    QRegion bottom_left = masks.logicalRegions[BottomLeft];
+    bottom_left.translate(0-shadowOffset+1, geo.height()-size-1);
     *blur_region = blur_region->subtracted(bottom_left);
 
+    record->shapes->blurShape = *blur_region;
+
     //qCWarning(LSHELPER) << geo.height() << w->contentsRect().height();
 
     /*QRegion top_left = *m_maskRegions[TopLeft];
@@ -145,95 +451,6 @@ LSHelper::roundBlurRegion(EffectWindow *w, QRegion *blur_region)
     *blur_region = blur_region->subtracted(bottom_left);*/
 }
 
-QPainterPath
-LSHelper::superellipse(float size, int n, int translate)
-{
-    float n2 = 2.0 / n;
-
-    int steps = 360;
-
-    float step = (2 * M_PI) / steps;
-
-    QPainterPath path;
-    path.moveTo(2*size, size);
-
-    for (int i = 1; i < steps; ++i)
-    {
-        float t = i * step;
-
-        float cosT = qCos(t);
-        float sinT = qSin(t);
-
-        float x = size + (qPow(qAbs(cosT), n2) * size * signum(cosT));
-        float y = size - (qPow(qAbs(sinT), n2) * size * signum(sinT));
-
-        path.lineTo(x, y);
-
-        //qCWarning(LSHELPER) << "x: " << x << ", y: " << y << ", t: " << t << ", size: " << size << ", sinT: " << sinT << ", cosT: " << cosT << ", n2: " << n2;
-    }
-    path.lineTo(2*size, size);
-
-    path.translate(translate,translate);
-
-    return path;
-}
-
-QImage
-LSHelper::genMaskImg(int size, bool mask, bool outer_rect)
-{
-    QImage img(size*2, size*2, QImage::Format_ARGB32_Premultiplied);
-    img.fill(Qt::transparent);
-    QPainter p(&img);
-    QRect r(img.rect());
-    int offset_decremented;
-    if(outer_rect) {
-        offset_decremented = m_shadowOffset-1;
-    } else {
-        offset_decremented = m_shadowOffset;
-    }
-
-    if(mask) {
-        p.fillRect(img.rect(), Qt::black);
-        p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-        p.setPen(Qt::NoPen);
-        p.setBrush(Qt::black);
-        p.setRenderHint(QPainter::Antialiasing);
-        if (m_cornersType == SquircledCorners) {
-            const QPainterPath squircle1 = superellipse((size-m_shadowOffset), m_squircleRatio, m_shadowOffset);
-            p.drawPolygon(squircle1.toFillPolygon());
-        } else {
-            p.drawEllipse(r.adjusted(m_shadowOffset,m_shadowOffset,-m_shadowOffset,-m_shadowOffset));
-        }
-    } else {
-        p.setPen(Qt::NoPen);
-        p.setRenderHint(QPainter::Antialiasing);
-        r.adjust(offset_decremented, offset_decremented, -offset_decremented, -offset_decremented);
-        if(outer_rect) {
-            p.setBrush(QColor(0, 0, 0, 255));
-        } else {
-            p.setBrush(QColor(255, 255, 255, 255));
-        }
-        if (m_cornersType == SquircledCorners) {
-            const QPainterPath squircle2 = superellipse((size-offset_decremented), m_squircleRatio, offset_decremented);
-            p.drawPolygon(squircle2.toFillPolygon());            
-        } else {
-            p.drawEllipse(r);
-        }
-        p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-        p.setBrush(Qt::black);
-        r.adjust(1, 1, -1, -1);
-        if (m_cornersType == SquircledCorners) {
-            const QPainterPath squircle3 = superellipse((size-(offset_decremented+1)), m_squircleRatio, (offset_decremented+1));
-            p.drawPolygon(squircle3.toFillPolygon());
-        } else {
-            p.drawEllipse(r);
-        }
-    }
-    p.end();
-
-    return img;
-}
-
 bool 
 LSHelper::hasShadow(EffectWindow *w)
 {
@@ -245,8 +462,9 @@ LSHelper::hasShadow(EffectWindow *w)
 bool 
 LSHelper::isManagedWindow(EffectWindow *w)
 {
+    // Fullscreen windows are managed, the effects suspend them while they
+    // are fullscreen, see LightlyShadersEffect::updatePaintState()
     if (w->isDesktop()
-            || w->isFullScreen()
             || w->isPopupMenu()
             || w->isTooltip() 
             || w->isSpecialWindow()
@@ -262,51 +480,131 @@ LSHelper::isManagedWindow(EffectWindow *w)
         return false;
 
     //qCWarning(LSHELPER) << w->windowRole() << w->windowType() << w->windowClass();
-    if (
-            (!w->hasDecoration()
-                && (
-                    w->windowClass().contains("plasma", Qt::CaseInsensitive)
-                    || w->windowClass().contains("krunner", Qt::CaseInsensitive)
-                    || w->windowClass().contains("sddm", Qt::CaseInsensitive)
-                    || w->windowClass().contains("vmware-user", Qt::CaseInsensitive)
-                    || w->windowClass().contains("latte-dock", Qt::CaseInsensitive)
-                    || w->windowClass().contains("lattedock", Qt::CaseInsensitive)
-                    || w->windowClass().contains("plank", Qt::CaseInsensitive)
-                    || w->windowClass().contains("cairo-dock", Qt::CaseInsensitive)
-                    || w->windowClass().contains("albert", Qt::CaseInsensitive)
-                    || w->windowClass().contains("ulauncher", Qt::CaseInsensitive)
-                    || w->windowClass().contains("ksplash", Qt::CaseInsensitive)
-                    || w->windowClass().contains("ksmserver", Qt::CaseInsensitive)
-                    || (w->windowClass().contains("reaper", Qt::CaseInsensitive) && !hasShadow(w))
-                )
-            )
-            || w->windowClass().contains("xwaylandvideobridge", Qt::CaseInsensitive)
-
-        ) return false;
-
-    if(w->windowClass().contains("jetbrains", Qt::CaseInsensitive) && w->caption().contains(QRegularExpression ("win[0-9]+")))
-        return false;
+    const quint64 matched = m_ruleMatcher.match(w->windowClass());
+    if (!matched)
+        return true;
 
-    if (w->windowClass().contains("plasma", Qt::CaseInsensitive) && !w->isNormalWindow() && !w->isDialog() && !w->isModal())
-        return false;
+    for (int i = 0; i < m_rules.size(); ++i) {
+        if (!(matched & (quint64(1) << i)))
+            continue;
+
+        switch (m_rules.at(i).condition) {
+            case Always:
+                return false;
+            case Undecorated:
+                if (!w->hasDecoration())
+                    return false;
+                break;
+            case UndecoratedWithoutShadow:
+                if (!w->hasDecoration() && !hasShadow(w))
+                    return false;
+                break;
+            case GeneratedCaption:
+                if (w->caption().contains(s_generatedCaption))
+                    return false;
+                break;
+            case NotNormalWindow:
+                if (!w->isNormalWindow() && !w->isDialog() && !w->isModal())
+                    return false;
+                break;
+        }
+    }
 
     //qCWarning(LSHELPER) << w->windowClass() << w->windowClass().contains("xwaylandvideobridge", Qt::CaseInsensitive);
     return true;
 }
 
 void
-LSHelper::blurWindowAdded(EffectWindow *w)
+LSHelper::compileRules()
+{
+    m_rules = {
+        {QStringLiteral("plasma"), Undecorated},
+        {QStringLiteral("krunner"), Undecorated},
+        {QStringLiteral("sddm"), Undecorated},
+        {QStringLiteral("vmware-user"), Undecorated},
+        {QStringLiteral("latte-dock"), Undecorated},
+        {QStringLiteral("lattedock"), Undecorated},
+        {QStringLiteral("plank"), Undecorated},
+        {QStringLiteral("cairo-dock"), Undecorated},
+        {QStringLiteral("albert"), Undecorated},
+        {QStringLiteral("ulauncher"), Undecorated},
+        {QStringLiteral("ksplash"), Undecorated},
+        {QStringLiteral("ksmserver"), Undecorated},
+        {QStringLiteral("reaper"), UndecoratedWithoutShadow},
+        {QStringLiteral("xwaylandvideobridge"), Always},
+        {QStringLiteral("jetbrains"), GeneratedCaption},
+        {QStringLiteral("plasma"), NotNormalWindow},
+    };
+
+    for (const QString &windowClass : qAsConst(m_config.excludedWindowClasses)) {
+        if (!windowClass.trimmed().isEmpty()) {
+            m_rules.append({windowClass.trimmed(), Always});
+        }
+    }
+
+    if (m_rules.size() > LSRuleMatcher::MaxPatterns) {
+        qCWarning(LSHELPER) << "Only" << LSRuleMatcher::MaxPatterns << "window class rules are supported, ignoring the rest";
+        m_rules.resize(LSRuleMatcher::MaxPatterns);
+    }
+
+    QStringList patterns;
+    for (const WindowRule &rule : qAsConst(m_rules)) {
+        patterns.append(rule.pattern);
+    }
+    m_ruleMatcher.compile(patterns);
+}
+
+LSWindowRecord &
+LSHelper::addWindow(EffectWindow *w)
+{
+    bool inserted = false;
+    LSWindowRecord &record = m_windows.insert(w, &inserted);
+    if (inserted) {
+        record.isManaged = isManagedWindow(w);
+    }
+    return record;
+}
+
+void
+LSHelper::classifyWindow(EffectWindow *w)
+{
+    LSWindowRecord *record = m_windows.find(w);
+    if (!record) {
+        return;
+    }
+
+    const bool managed = isManagedWindow(w);
+    if (managed == record->isManaged) {
+        return;
+    }
+
+    record->isManaged = managed;
+    record->blurShapeValid = false;
+    record->geometryValid = false;
+    Q_EMIT managedChanged(w);
+    w->addRepaintFull();
+}
+
+LSWindowRecord *
+LSHelper::findWindow(const EffectWindow *w)
+{
+    return m_windows.find(w);
+}
+
+void
+LSHelper::removeWindow(EffectWindow *w)
 {
-    if(isManagedWindow(w)) {
-        m_managed.append(w);
+    if (LSWindowRecord *record = m_windows.find(w)) {
+        QObject::disconnect(record->shapes->blurChangedConnection);
+        m_windows.remove(w);
     }
 }
 
 void
-LSHelper::blurWindowDeleted(EffectWindow *w)
+LSHelper::invalidateBlurShape(EffectWindow *w)
 {
-    if(m_managed.contains(w)) {
-        m_managed.removeAll(w);
+    if (LSWindowRecord *record = m_windows.find(w)) {
+        record->blurShapeValid = false;
     }
 }
 
@@ -1,13 +1,13 @@
 #include "liblshelper_export.h"
+#include "lsconfig.h"
+#include "lsrulematcher.h"
+#include "lswindowregistry.h"
 
 #include <kwinoffscreeneffect.h>
+#include <QFutureWatcher>
 #include <QRegion>
-#include <QImage>
-#include <QPainterPath>
-
-template <typename T> int signum(T val) {
-    return (T(0) < val) - (val < T(0));
-}
+#include <QSharedPointer>
+#include <QVector>
 
 namespace KWin {
 
@@ -16,31 +16,95 @@ class LIBLSHELPER_EXPORT LSHelper: public QObject
     Q_OBJECT
 
 	public:
-		LSHelper();
 		~LSHelper();
 
+		// The helper shared by every effect in the compositor, created on
+		// first use and destroyed when the last effect releases it
+		static QSharedPointer<LSHelper> instance();
+
 		void reconfigure();
-		QPainterPath superellipse(float size, int n, int translate);
-    	QImage genMaskImg(int size, bool mask, bool outer_rect);
+		const LSConfig &config() const;
 		void roundBlurRegion(EffectWindow *w, QRegion *region);
 		bool isManagedWindow(EffectWindow *w);
-		void blurWindowAdded(EffectWindow *w);
-		void blurWindowDeleted(EffectWindow *w);
+		LSWindowRecord &addWindow(EffectWindow *w);
+		LSWindowRecord *findWindow(const EffectWindow *w);
+		void removeWindow(EffectWindow *w);
+		void invalidateBlurShape(EffectWindow *w);
 		int roundness();
 
 		enum { RoundedCorners = 0, SquircledCorners };
+		enum { RedirectWindow = 0, CornersOnly };
 		enum { TopLeft = 0, TopRight, BottomRight, BottomLeft, NTex };
 
-		QRegion* m_maskRegions[NTex];
+		struct MaskKey
+		{
+			int radius;
+			qreal scale;
+			int cornersType;
+			int squircleRatio;
+			int shadowOffset;
+
+			bool operator==(const MaskKey &other) const;
+		};
+
+		// Corner masks rasterized in device pixels of one output scale,
+		// together with the same masks mapped back to logical pixels.
+		// translucentRegions are the logical pixels of a radius sized tile
+		// at each frame corner that the shader does not paint fully opaque.
+		struct MaskSet
+		{
+			MaskKey key;
+			int size = 0;
+			QRegion regions[NTex];
+			QRegion logicalRegions[NTex];
+			QRegion translucentRegions[NTex];
+		};
+
+		MaskSet maskSet(qreal scale = 1.0);
+		MaskSet maskSet(EffectScreen *screen);
+
+		// The corner masks of a MaskSet, public for tests/lsmaskbenchmark
+		static QVector<int> cornerSpans(int size, int radius, int cornersType, int squircleRatio);
+		static QRegion createMaskRegion(const QVector<int> &spans, int size, int corner);
+
+	Q_SIGNALS:
+		// The window is shaded now and wasn't before, or the other way round
+		void managedChanged(KWin::EffectWindow *w);
 
 	private:
+		LSHelper();
+
+		// What, besides the window class, excludes a window
+		enum RuleCondition { Always = 0, Undecorated, UndecoratedWithoutShadow, GeneratedCaption, NotNormalWindow };
+
+		struct WindowRule
+		{
+			QString pattern;
+			RuleCondition condition;
+		};
+
+		void classifyWindow(EffectWindow *w);
+		void compileRules();
 		bool hasShadow(EffectWindow *w);
 		void setMaskRegions();
-		QRegion* createMaskRegion(QImage img, int size, int corner);
+		MaskKey maskKey(qreal scale) const;
+		void requestMaskSet(const MaskKey &key);
+		static MaskSet createMaskSet(const MaskKey &key);
+		static QVector<int> translucentSpans(int radius, qreal scale, int cornersType, int squircleRatio);
+		static QRegion toLogicalRegion(const QRegion &region, qreal scale);
 
 		int m_size, m_cornersType, m_squircleRatio, m_shadowOffset;
 		bool m_disabledForMaximized;
-		QList<EffectWindow *> m_managed;
+		LSWindowRegistry m_windows;
+
+		bool m_configured = false;
+		LSConfig m_config;
+		QVector<WindowRule> m_rules;
+		LSRuleMatcher m_ruleMatcher;
+
+		QVector<MaskSet> m_maskCache;
+		QVector<MaskKey> m_pendingMasks;
+		QVector<QFutureWatcher<MaskSet> *> m_maskWatchers;
 };
 
 } //namespace
\ No newline at end of file
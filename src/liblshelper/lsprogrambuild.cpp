@@ -0,0 +1,167 @@
+#include "lsprogrambuild.h"
+#include "lsprogramcache.h"
+
+#include <kwinglplatform.h>
+
+namespace KWin {
+
+LSProgramBuild::LSProgramBuild(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+    : m_traits(traits)
+    , m_vertexSource(vertexSource)
+    , m_fragmentSource(fragmentSource)
+{
+    start();
+}
+
+LSProgramBuild::LSProgramBuild(ShaderTraits traits, const QString &vertexFile, const QString &fragmentFile)
+    : m_traits(traits)
+{
+    // Files that can't be read are left to finish(), so ShaderManager
+    // reports them
+    if (LSProgramCache::readSources(vertexFile, fragmentFile, &m_vertexSource, &m_fragmentSource)) {
+        start();
+    } else {
+        m_vertexFile = vertexFile;
+        m_fragmentFile = fragmentFile;
+    }
+}
+
+LSProgramBuild::~LSProgramBuild()
+{
+    for (GLuint shader : m_shaders) {
+        if (shader) {
+            glDeleteShader(shader);
+        }
+    }
+    if (m_program) {
+        glDeleteProgram(m_program);
+    }
+}
+
+bool
+LSProgramBuild::parallelSupported()
+{
+    // Programs linked here reach a GLShader only through their binary
+    static const bool supported = LSProgramCache::isSupported()
+        && (hasGLExtension(QByteArrayLiteral("GL_KHR_parallel_shader_compile"))
+            || hasGLExtension(QByteArrayLiteral("GL_ARB_parallel_shader_compile")));
+    return supported;
+}
+
+bool
+LSProgramBuild::isParallel() const
+{
+    return m_program != 0;
+}
+
+bool
+LSProgramBuild::isReady() const
+{
+    if (m_shader) {
+        return true;
+    }
+    if (!m_program) {
+        return false;
+    }
+
+    // Never blocks, unlike the link status
+    GLint done = GL_FALSE;
+    glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+// Same as GLShader::prepareSource()
+static QByteArray
+prepareSource(const QByteArray &source)
+{
+    GLPlatform *platform = GLPlatform::instance();
+    QByteArray prepared;
+    if (platform->isGLES() && platform->glslVersion() < kVersionNumber(3, 0)) {
+        prepared.append("precision highp float;\n");
+    }
+    prepared.append(source);
+    if (platform->isGLES() && platform->glslVersion() >= kVersionNumber(3, 0)) {
+        prepared.replace("#version 140", "#version 300 es\n\nprecision highp float;\n");
+    }
+    return prepared;
+}
+
+GLuint
+LSProgramBuild::compile(GLenum type, const QByteArray &source)
+{
+    const QByteArray prepared = prepareSource(source);
+    const char *data = prepared.constData();
+    const GLint length = prepared.size();
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &data, &length);
+    glCompileShader(shader);
+    glAttachShader(m_program, shader);
+    return shader;
+}
+
+void
+LSProgramBuild::start()
+{
+    if (!LSProgramCache::isSupported()) {
+        return;
+    }
+
+    m_path = LSProgramCache::cachePath(m_traits, m_vertexSource, m_fragmentSource);
+    m_shader = LSProgramCache::load(m_path);
+    if (m_shader || !parallelSupported()) {
+        return;
+    }
+
+    // Linked like ShaderManager::generateCustomShader() does, without
+    // asking for the status
+    ShaderManager *manager = ShaderManager::instance();
+    m_program = glCreateProgram();
+    m_shaders[0] = compile(GL_VERTEX_SHADER, m_vertexSource.isEmpty() ? manager->generateVertexSource(m_traits) : m_vertexSource);
+    m_shaders[1] = compile(GL_FRAGMENT_SHADER, m_fragmentSource.isEmpty() ? manager->generateFragmentSource(m_traits) : m_fragmentSource);
+
+    glBindAttribLocation(m_program, VA_Position, "position");
+    glBindAttribLocation(m_program, VA_TexCoord, "texcoord");
+    if (!GLPlatform::instance()->isGLES() && (hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_gpu_shader4")))) {
+        glBindFragDataLocation(m_program, 0, "fragColor");
+    }
+    glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(m_program);
+}
+
+std::unique_ptr<GLShader>
+LSProgramBuild::finish()
+{
+    if (m_shader) {
+        return std::move(m_shader);
+    }
+
+    if (!m_program) {
+        if (!m_vertexFile.isEmpty() || !m_fragmentFile.isEmpty()) {
+            return LSProgramCache::generateShaderFromFile(m_traits, m_vertexFile, m_fragmentFile);
+        }
+        return LSProgramCache::generateCustomShader(m_traits, m_vertexSource, m_fragmentSource);
+    }
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+    std::unique_ptr<GLShader> shader;
+    if (status == GL_TRUE) {
+        shader = LSProgramCache::store(m_path, m_program);
+    }
+
+    for (GLuint &object : m_shaders) {
+        glDeleteShader(object);
+        object = 0;
+    }
+    glDeleteProgram(m_program);
+    m_program = 0;
+
+    // If it failed ShaderManager builds it again and reports why
+    if (!shader) {
+        shader = std::unique_ptr<GLShader>(ShaderManager::instance()->generateCustomShader(m_traits, m_vertexSource, m_fragmentSource));
+    }
+    return shader;
+}
+
+} // namespace KWin
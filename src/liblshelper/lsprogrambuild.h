@@ -0,0 +1,54 @@
+#pragma once
+
+#include "liblshelper_export.h"
+
+#include <kwinglutils.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+
+namespace KWin {
+
+/*
+ * A shader program that is built without stalling the compositor. With
+ * KHR_parallel_shader_compile the driver compiles and links it on its own
+ * threads and isReady() only asks whether it's done. Programs in
+ * LSProgramCache are ready right away. Everything else is compiled by
+ * finish(), which owners should call for one such program per frame.
+ */
+class LIBLSHELPER_EXPORT LSProgramBuild
+{
+public:
+    // Like the LSProgramCache functions
+    LSProgramBuild(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+    LSProgramBuild(ShaderTraits traits, const QString &vertexFile, const QString &fragmentFile);
+    ~LSProgramBuild();
+
+    // Whether the driver builds the program, so finish() never compiles
+    bool isParallel() const;
+    // Whether finish() returns without waiting for a compiler
+    bool isReady() const;
+
+    // The program, invalid if it doesn't build
+    std::unique_ptr<GLShader> finish();
+
+private:
+    static bool parallelSupported();
+    void start();
+    GLuint compile(GLenum type, const QByteArray &source);
+
+    ShaderTraits m_traits;
+    QByteArray m_vertexSource;
+    QByteArray m_fragmentSource;
+    QString m_vertexFile;
+    QString m_fragmentFile;
+    QString m_path;
+
+    std::unique_ptr<GLShader> m_shader;
+    GLuint m_program = 0;
+    GLuint m_shaders[2] = {0, 0};
+};
+
+} // namespace KWin
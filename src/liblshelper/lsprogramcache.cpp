@@ -0,0 +1,298 @@
+#include "lsprogramcache.h"
+
+#include <kwinglplatform.h>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_DECLARE_LOGGING_CATEGORY(LSHELPER)
+
+namespace KWin {
+
+static const quint32 s_magic = 0x4c535042; // "LSPB"
+static const quint32 s_version = 1;
+// Every variant of both effects with a few squircle ratios, plus the
+// previous configuration
+static const int s_maxPrograms = 64;
+
+/*
+ * GLShader only becomes valid by linking sources, so a pass-through
+ * program is linked first and its executable replaced by the binary,
+ * before anything looks up a uniform location. The binary brings the
+ * attribute and output bindings of the program it was taken from.
+ */
+class LSBinaryShader : public GLShader
+{
+public:
+    LSBinaryShader()
+        : GLShader(ExplicitLinking)
+    {
+    }
+
+    bool loadBinary(GLenum format, const QByteArray &binary)
+    {
+        ShaderManager *manager = ShaderManager::instance();
+        if (!load(manager->generateVertexSource(ShaderTrait::MapTexture),
+                  manager->generateFragmentSource(ShaderTrait::MapTexture))
+            || !link()) {
+            return false;
+        }
+
+        ShaderBinder binder(this);
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        glProgramBinary(program, format, binary.constData(), binary.size());
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        return status == GL_TRUE;
+    }
+};
+
+// Same choice of file as ShaderManager::generateShaderFromFile()
+static QString
+resolveShaderFile(const QString &file)
+{
+    const qint64 coreVersionNumber = GLPlatform::instance()->isGLES() ? kVersionNumber(3, 0) : kVersionNumber(1, 40);
+    if (GLPlatform::instance()->glslVersion() < coreVersionNumber) {
+        return file;
+    }
+    const int extension = file.lastIndexOf(QLatin1Char('.'));
+    return file.left(extension) + QStringLiteral("_core") + file.mid(extension);
+}
+
+static bool
+readShaderFile(const QString &file, QByteArray *source)
+{
+    if (file.isEmpty()) {
+        return true;
+    }
+    QFile f(resolveShaderFile(file));
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    *source = f.readAll();
+    return true;
+}
+
+static bool
+programBinary(GLuint program, GLenum *format, QByteArray *binary)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    binary->resize(length);
+    glGetProgramBinary(program, length, &length, format, binary->data());
+    binary->resize(length);
+    return length > 0;
+}
+
+std::unique_ptr<GLShader>
+LSProgramCache::generateCustomShader(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    ShaderManager *manager = ShaderManager::instance();
+    if (!isSupported()) {
+        return std::unique_ptr<GLShader>(manager->generateCustomShader(traits, vertexSource, fragmentSource));
+    }
+
+    const QString path = cachePath(traits, vertexSource, fragmentSource);
+    if (std::unique_ptr<GLShader> shader = load(path)) {
+        return shader;
+    }
+
+    std::unique_ptr<GLShader> shader(manager->generateCustomShader(traits, vertexSource, fragmentSource));
+    if (shader->isValid()) {
+        ShaderBinder binder(shader.get());
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        GLenum format = 0;
+        QByteArray binary;
+        if (programBinary(program, &format, &binary)) {
+            writeBinary(path, format, binary);
+        }
+    }
+    return shader;
+}
+
+std::unique_ptr<GLShader>
+LSProgramCache::generateShaderFromFile(ShaderTraits traits, const QString &vertexFile, const QString &fragmentFile)
+{
+    // ShaderManager reports files it can't read
+    QByteArray vertexSource;
+    QByteArray fragmentSource;
+    if (!readSources(vertexFile, fragmentFile, &vertexSource, &fragmentSource)) {
+        return std::unique_ptr<GLShader>(ShaderManager::instance()->generateShaderFromFile(traits, vertexFile, fragmentFile));
+    }
+    return generateCustomShader(traits, vertexSource, fragmentSource);
+}
+
+bool
+LSProgramCache::isSupported()
+{
+    static const bool supported = []() {
+        if (GLPlatform::instance()->isGLES()) {
+            if (!hasGLVersion(3, 0)) {
+                return false;
+            }
+        } else if (!hasGLVersion(4, 1) && !hasGLExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+            return false;
+        }
+        // Drivers may support the calls without any binary format
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported;
+}
+
+bool
+LSProgramCache::readSources(const QString &vertexFile, const QString &fragmentFile, QByteArray *vertexSource, QByteArray *fragmentSource)
+{
+    return readShaderFile(vertexFile, vertexSource) && readShaderFile(fragmentFile, fragmentSource);
+}
+
+QString
+LSProgramCache::cacheDirectory()
+{
+    static const QString directory = []() {
+        GLPlatform *platform = GLPlatform::instance();
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(platform->glVendorString());
+        hash.addData(platform->glRendererString());
+        hash.addData(platform->glVersionString());
+        const QString driver = QString::fromLatin1(hash.result().toHex());
+
+        // Binaries of other drivers, or older versions of this one, never
+        // load again. Neither do files from before drivers had their own
+        // directory.
+        const QString programs = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + QStringLiteral("/lightlyshaders/programs");
+        const QFileInfoList entries = QDir(programs).entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        for (const QFileInfo &entry : entries) {
+            if (!entry.isDir()) {
+                QFile::remove(entry.absoluteFilePath());
+            } else if (entry.fileName() != driver) {
+                QDir(entry.absoluteFilePath()).removeRecursively();
+            }
+        }
+
+        return programs + QLatin1Char('/') + driver;
+    }();
+    return directory;
+}
+
+QString
+LSProgramCache::cachePath(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    // Empty sources are generated from the traits by this KWin version
+    ShaderManager *manager = ShaderManager::instance();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(int(traits)));
+    hash.addData(vertexSource.isEmpty() ? manager->generateVertexSource(traits) : vertexSource);
+    hash.addData(QByteArrayLiteral("\n--\n"));
+    hash.addData(fragmentSource.isEmpty() ? manager->generateFragmentSource(traits) : fragmentSource);
+
+    return cacheDirectory()
+        + QLatin1Char('/')
+        + QString::fromLatin1(hash.result().toHex())
+        + QStringLiteral(".bin");
+}
+
+void
+LSProgramCache::prune(const QString &directory)
+{
+    // Loading a binary touches it, so the least recently used go first
+    const QFileInfoList files = QDir(directory).entryInfoList({QStringLiteral("*.bin")}, QDir::Files, QDir::Time);
+    for (int i = s_maxPrograms; i < files.size(); ++i) {
+        QFile::remove(files.at(i).absoluteFilePath());
+    }
+}
+
+bool
+LSProgramCache::readBinary(const QString &path, GLenum *format, QByteArray *binary)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 binaryFormat = 0;
+    stream >> magic >> version >> binaryFormat >> *binary;
+    if (stream.status() != QDataStream::Ok || magic != s_magic || version != s_version || binary->isEmpty()) {
+        return false;
+    }
+
+    *format = binaryFormat;
+    return true;
+}
+
+std::unique_ptr<GLShader>
+LSProgramCache::load(const QString &path)
+{
+    GLenum format = 0;
+    QByteArray binary;
+    if (!readBinary(path, &format, &binary)) {
+        return nullptr;
+    }
+    auto shader = std::make_unique<LSBinaryShader>();
+    if (!shader->loadBinary(format, binary)) {
+        qCDebug(LSHELPER) << "Stale program binary" << path;
+        QFile::remove(path);
+        return nullptr;
+    }
+
+    QFile file(path);
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+    return shader;
+}
+
+std::unique_ptr<GLShader>
+LSProgramCache::store(const QString &path, GLuint program)
+{
+    GLenum format = 0;
+    QByteArray binary;
+    if (!programBinary(program, &format, &binary)) {
+        return nullptr;
+    }
+    writeBinary(path, format, binary);
+    auto shader = std::make_unique<LSBinaryShader>();
+    if (!shader->loadBinary(format, binary)) {
+        return nullptr;
+    }
+    return shader;
+}
+
+void
+LSProgramCache::writeBinary(const QString &path, GLenum format, const QByteArray &binary)
+{
+    // Written whole or not at all, so a crash can't leave half a binary
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << s_magic << s_version << quint32(format) << binary;
+    if (!file.commit()) {
+        qCDebug(LSHELPER) << "Can't write program binary" << path;
+        return;
+    }
+    prune(QFileInfo(path).absolutePath());
+}
+
+} // namespace KWin
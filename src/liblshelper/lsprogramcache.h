@@ -0,0 +1,47 @@
+#pragma once
+
+#include "liblshelper_export.h"
+
+#include <kwinglutils.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+
+namespace KWin {
+
+/*
+ * Keeps linked shader programs on disk, so effects that KWin recreates on
+ * compositing restarts and effect toggles load their programs instead of
+ * compiling them again. Programs are keyed by their sources, variant
+ * defines included, and the shader traits, in a directory per GL vendor,
+ * renderer and version. Directories of other drivers are removed and the
+ * least recently used programs beyond a few dozen too. Whatever fails
+ * falls back to compiling through ShaderManager.
+ */
+class LIBLSHELPER_EXPORT LSProgramCache
+{
+public:
+    // Like the ShaderManager functions of the same names
+    static std::unique_ptr<GLShader> generateCustomShader(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+    static std::unique_ptr<GLShader> generateShaderFromFile(ShaderTraits traits, const QString &vertexFile, const QString &fragmentFile);
+
+private:
+    friend class LSProgramBuild;
+
+    static bool isSupported();
+    static bool readSources(const QString &vertexFile, const QString &fragmentFile, QByteArray *vertexSource, QByteArray *fragmentSource);
+    // The directory of the current driver, the first call prunes the others
+    static QString cacheDirectory();
+    static QString cachePath(ShaderTraits traits, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+    static void prune(const QString &directory);
+    // nullptr if there is no usable binary
+    static std::unique_ptr<GLShader> load(const QString &path);
+    // Stores the binary of the linked program and loads it into a GLShader
+    static std::unique_ptr<GLShader> store(const QString &path, GLuint program);
+    static bool readBinary(const QString &path, GLenum *format, QByteArray *binary);
+    static void writeBinary(const QString &path, GLenum format, const QByteArray &binary);
+};
+
+} // namespace KWin
@@ -0,0 +1,80 @@
+#include "lsrulematcher.h"
+
+#include <QQueue>
+
+namespace KWin {
+
+LSRuleMatcher::LSRuleMatcher()
+{
+    compile(QStringList());
+}
+
+void
+LSRuleMatcher::compile(const QStringList &patterns)
+{
+    m_states.clear();
+    m_states.append(State());
+
+    // Build the trie of the case folded patterns
+    const int count = qMin(int(patterns.size()), int(MaxPatterns));
+    for (int i = 0; i < count; ++i) {
+        const QString pattern = patterns.at(i).toCaseFolded();
+        if (pattern.isEmpty()) {
+            continue;
+        }
+
+        int state = 0;
+        for (const QChar c : pattern) {
+            int next = m_states[state].next.value(c, -1);
+            if (next < 0) {
+                next = m_states.size();
+                m_states[state].next.insert(c, next);
+                m_states.append(State());
+            }
+            state = next;
+        }
+        m_states[state].output |= quint64(1) << i;
+    }
+
+    // Link every state to its longest proper suffix in the trie, breadth first
+    QQueue<int> queue;
+    for (const int child : qAsConst(m_states[0].next)) {
+        queue.enqueue(child);
+    }
+
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        const QHash<QChar, int> next = m_states[state].next;
+
+        for (auto it = next.constBegin(); it != next.constEnd(); ++it) {
+            int fail = m_states[state].fail;
+            while (fail && !m_states[fail].next.contains(it.key())) {
+                fail = m_states[fail].fail;
+            }
+            fail = m_states[fail].next.value(it.key(), 0);
+
+            m_states[it.value()].fail = fail;
+            m_states[it.value()].output |= m_states[fail].output;
+            queue.enqueue(it.value());
+        }
+    }
+}
+
+quint64
+LSRuleMatcher::match(const QString &text) const
+{
+    quint64 matched = 0;
+    int state = 0;
+
+    for (const QChar c : text.toCaseFolded()) {
+        while (state && !m_states[state].next.contains(c)) {
+            state = m_states[state].fail;
+        }
+        state = m_states[state].next.value(c, 0);
+        matched |= m_states[state].output;
+    }
+
+    return matched;
+}
+
+} //namespace
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "liblshelper_export.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace KWin {
+
+/*
+ * Finds which of a set of patterns occur in a string, ignoring case,
+ * in a single pass over the string (Aho-Corasick). Up to 64 patterns
+ * are supported, pattern i sets bit i of the match result.
+ */
+class LIBLSHELPER_EXPORT LSRuleMatcher
+{
+public:
+    static const int MaxPatterns = 64;
+
+    LSRuleMatcher();
+
+    void compile(const QStringList &patterns);
+    quint64 match(const QString &text) const;
+
+private:
+    struct State
+    {
+        QHash<QChar, int> next;
+        int fail = 0;
+        quint64 output = 0;
+    };
+
+    QVector<State> m_states;
+};
+
+} //namespace
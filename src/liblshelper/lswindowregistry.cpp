@@ -0,0 +1,124 @@
+#include "lswindowregistry.h"
+
+namespace KWin {
+
+// Must be a power of two
+static const int s_initialCapacityBits = 6;
+
+LSWindowRegistry::LSWindowRegistry()
+{
+    clear();
+}
+
+size_t
+LSWindowRegistry::home(const EffectWindow *w) const
+{
+    // Fibonacci hashing, heap pointers have no entropy in their low bits
+    return size_t((quint64(quintptr(w)) * Q_UINT64_C(0x9E3779B97F4A7C15)) >> m_shift);
+}
+
+size_t
+LSWindowRegistry::probe(const EffectWindow *w) const
+{
+    size_t i = home(w);
+    while (m_slots[i].window && m_slots[i].window != w) {
+        i = (i + 1) & m_mask;
+    }
+    return i;
+}
+
+LSWindowRecord *
+LSWindowRegistry::find(const EffectWindow *w)
+{
+    LSWindowRecord &record = m_slots[probe(w)];
+    return record.window ? &record : nullptr;
+}
+
+const LSWindowRecord *
+LSWindowRegistry::find(const EffectWindow *w) const
+{
+    const LSWindowRecord &record = m_slots[probe(w)];
+    return record.window ? &record : nullptr;
+}
+
+LSWindowRecord &
+LSWindowRegistry::insert(EffectWindow *w, bool *inserted)
+{
+    size_t i = probe(w);
+    const bool isNew = !m_slots[i].window;
+    if (isNew) {
+        // Keep the load factor below 3/4, only growing for a new window
+        // keeps the records of existing ones in place
+        if (size_t(m_size + 1) * 4 > m_slots.size() * 3) {
+            grow();
+            i = probe(w);
+        }
+        LSWindowRecord &record = m_slots[i];
+        record = LSWindowRecord();
+        record.window = w;
+        record.shapes = std::make_unique<LSWindowShapes>();
+        ++m_size;
+    }
+    if (inserted) {
+        *inserted = isNew;
+    }
+    return m_slots[i];
+}
+
+void
+LSWindowRegistry::remove(const EffectWindow *w)
+{
+    size_t i = probe(w);
+    if (!m_slots[i].window) {
+        return;
+    }
+
+    // Move later records of the probe sequence into the hole, unless
+    // that would put them in front of their home slot
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & m_mask;
+        if (!m_slots[j].window) {
+            break;
+        }
+        const size_t k = home(m_slots[j].window);
+        const bool inPlace = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (inPlace) {
+            continue;
+        }
+        m_slots[i] = std::move(m_slots[j]);
+        i = j;
+    }
+
+    m_slots[i] = LSWindowRecord();
+    --m_size;
+}
+
+void
+LSWindowRegistry::clear()
+{
+    m_slots.clear();
+    m_slots.resize(size_t(1) << s_initialCapacityBits);
+    m_mask = m_slots.size() - 1;
+    m_shift = 64 - s_initialCapacityBits;
+    m_size = 0;
+}
+
+void
+LSWindowRegistry::grow()
+{
+    std::vector<LSWindowRecord> old = std::move(m_slots);
+
+    m_slots.clear();
+    m_slots.resize(old.size() * 2);
+    m_mask = m_slots.size() - 1;
+    --m_shift;
+
+    for (LSWindowRecord &record : old) {
+        if (record.window) {
+            m_slots[probe(record.window)] = std::move(record);
+        }
+    }
+}
+
+} //namespace
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "liblshelper_export.h"
+
+#include <QMetaObject>
+#include <QRectF>
+#include <QRegion>
+#include <QSizeF>
+#include <QVector>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace KWin {
+
+class EffectScreen;
+class EffectWindow;
+
+/*
+ * Regions and slices cached for one window. They live outside of the
+ * registry slots, so growing the table or shifting records back only
+ * moves a pointer to them.
+ */
+struct LSWindowShapes
+{
+    // Corner pixels LightlyShadersEffect removes from the opaque region
+    QRegion cornerExclusion;
+    // Parts of the window drawn with and without the corner shader,
+    // relative to the frame
+    QVector<QRectF> shadedSlices;
+    QVector<QRectF> plainSlices;
+
+    // Blur region requested by the client, if any
+    QRegion blurRegion;
+    QMetaObject::Connection blurChangedConnection;
+
+    // Rounded blur region and the requested region it was computed from
+    QRegion blurShapeRegion;
+    QRegion blurShape;
+};
+
+/*
+ * What LightlyShaders and its blur effect check about one window on every
+ * frame. The regions derived from it are in shapes.
+ */
+struct LSWindowRecord
+{
+    EffectWindow *window = nullptr;
+
+    // Classification by LSHelper::isManagedWindow()
+    bool isManaged = false;
+    // Maximized while rounding is disabled for maximized windows
+    bool skipEffect = false;
+
+    // How LightlyShadersEffect paints the window. Only Offscreen keeps the
+    // window redirected, with its offscreen texture.
+    enum PaintState : quint8 { Unshaded = 0, Offscreen, Direct, Suspended };
+    PaintState paintState = Unshaded;
+    // Offscreen windows are redirected when first painted and released
+    // again when not painted for a while, counted in frames of the output
+    // the window was last painted on
+    bool redirected = false;
+    EffectScreen *lastPaintScreen = nullptr;
+    quint64 lastPaintFrame = 0;
+
+    // Geometry LightlyShadersEffect derives for painting, invalidated when
+    // the frame geometry, the output scale, the config or the mask set
+    // change. The expanded geometry has no change signal and is compared.
+    bool geometryValid = false;
+    qreal geometryScale = 1.0;
+    QRectF geometryExpanded;
+    QRectF scaledFrame;
+    QRectF scaledExpanded;
+
+    // Whether the client requested a blur region, and whether the rounded
+    // blur shape is still valid for the frame size and region hash
+    bool hasBlurRegion = false;
+    bool blurShapeValid = false;
+    uint blurShapeHash = 0;
+    QSizeF blurShapeFrameSize;
+
+    // Allocated when the window is inserted
+    std::unique_ptr<LSWindowShapes> shapes;
+};
+
+/*
+ * Open addressing hash table of window records, keyed by the window.
+ * It uses linear probing and backward shift deletion, so lookups never
+ * walk over tombstones. Inserting a new window and removing one may move
+ * records, so pointers returned by find() are only valid until the next
+ * one of those. Inserting a window that is already there moves nothing.
+ */
+class LIBLSHELPER_EXPORT LSWindowRegistry
+{
+public:
+    LSWindowRegistry();
+
+    LSWindowRecord *find(const EffectWindow *w);
+    const LSWindowRecord *find(const EffectWindow *w) const;
+    LSWindowRecord &insert(EffectWindow *w, bool *inserted = nullptr);
+    void remove(const EffectWindow *w);
+    void clear();
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    template<typename F>
+    void forEach(F f)
+    {
+        for (LSWindowRecord &record : m_slots) {
+            if (record.window) {
+                f(record);
+            }
+        }
+    }
+
+private:
+    size_t home(const EffectWindow *w) const;
+    size_t probe(const EffectWindow *w) const;
+    void grow();
+
+    std::vector<LSWindowRecord> m_slots;
+    size_t m_mask;
+    int m_shift;
+    int m_size = 0;
+};
+
+} //namespace
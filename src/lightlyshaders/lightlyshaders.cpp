@@ -18,7 +18,6 @@
  */
 
 #include "lightlyshaders.h"
-#include "lightlyshaders_config.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QImage>
@@ -34,6 +33,11 @@
 #include <QBitmap>
 #include <KWindowEffects>
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
 Q_LOGGING_CATEGORY(LIGHTLYSHADERS, "kwin_effect_lightlyshaders", QtWarningMsg)
 
 static void ensureResources()
@@ -51,18 +55,25 @@ KWIN_EFFECT_FACTORY_SUPPORTED_ENABLED(  LightlyShadersEffect,
 
 LightlyShadersEffect::LightlyShadersEffect() : OffscreenEffect()
 {
+    m_loadTimer.start();
     ensureResources();
 
-    m_helper = new LSHelper();
+    m_helper = LSHelper::instance();
     reconfigure(ReconfigureAll);
 
-    m_shader = std::unique_ptr<GLShader>(ShaderManager::instance()->generateShaderFromFile(ShaderTrait::MapTexture, QStringLiteral(""), QStringLiteral(":/effects/lightlyshaders/shaders/lightlyshaders.frag")));
-
-    if (!m_shader) {
-        qCWarning(LIGHTLYSHADERS) << "Failed to load shader";
-        return;
+    const auto screens = effects->screens();
+    for (EffectScreen *s : screens) {
+        screenAdded(s);
     }
+    connect(effects, &EffectsHandler::screenAdded, this, &LightlyShadersEffect::screenAdded);
+    connect(effects, &EffectsHandler::screenRemoved, this, &LightlyShadersEffect::screenRemoved);
+
+    m_shader = std::make_unique<LSShader>();
+    m_cornerRenderer = std::make_unique<LSCornerRenderer>();
+    m_frameTimer = std::make_unique<LSFrameTimer>(LIGHTLYSHADERS);
+    prepareShaders();
 
+    // Valid while the shaders build, reportLoadTime() warns if they fail
     if (m_shader->isValid())
     {
         const auto stackingOrder = effects->stackingOrder();
@@ -71,77 +82,264 @@ LightlyShadersEffect::LightlyShadersEffect() : OffscreenEffect()
         }
 
         connect(effects, &EffectsHandler::windowAdded, this, &LightlyShadersEffect::windowAdded);
-        connect(effects, &EffectsHandler::windowDeleted, this, &LightlyShadersEffect::windowDeleted);
+        // Set up like a new window when LSHelper classifies it again
+        connect(m_helper.data(), &LSHelper::managedChanged, this, &LightlyShadersEffect::windowAdded);
+        connect(effects, &EffectsHandler::windowDeleted, this, [this](EffectWindow *w) {
+            m_redirected.removeOne(w);
+            releaseShadowTiles(w);
+            if (m_activeWindow == w) {
+                m_activeWindow = nullptr;
+            }
+        });
+        connect(effects, &EffectsHandler::windowDecorationChanged, this, &LightlyShadersEffect::invalidateShadowTiles);
+        // Decorations may shadow active and inactive windows differently,
+        // only the window losing and the one gaining focus change
+        m_activeWindow = effects->activeWindow();
+        connect(effects, &EffectsHandler::windowActivated, this, [this](EffectWindow *w) {
+            invalidateShadowTiles(m_activeWindow);
+            invalidateShadowTiles(w);
+            m_activeWindow = w;
+        });
+        connect(effects, &EffectsHandler::windowMaximizedStateChanged,
+                this, &LightlyShadersEffect::windowMaximizedStateChanged);
+        connect(effects, &EffectsHandler::windowFullScreenChanged,
+                this, &LightlyShadersEffect::windowFullScreenChanged);
 
         qCWarning(LIGHTLYSHADERS) << "LightlyShaders loaded.";
     }
-    else
-        qCWarning(LIGHTLYSHADERS) << "LightlyShaders: no valid shaders found! LightlyShaders will not work.";
 }
 
 LightlyShadersEffect::~LightlyShadersEffect()
 {
-    m_windows.clear();
+    // The shared helper outlives the effect if the blur effect still uses
+    // it, a reloaded effect has to start from unshaded windows
+    const auto stackingOrder = effects->stackingOrder();
+    for (EffectWindow *w : stackingOrder) {
+        if (LSWindowRecord *record = m_helper->findWindow(w)) {
+            record->paintState = LSWindowRecord::Unshaded;
+            record->redirected = false;
+        }
+    }
+
+    // The GL resources of the corner renderer and frame timer
+    effects->makeOpenGLContextCurrent();
+    m_shadowTiles.clear();
+    m_shader.reset();
+    m_cornerRenderer.reset();
+    m_frameTimer.reset();
 }
 
 void
-LightlyShadersEffect::windowDeleted(EffectWindow *w)
+LightlyShadersEffect::windowAdded(EffectWindow *w)
 {
-    m_windows.remove(w);
+    // LSHelper registered the window before this slot runs
+    LSWindowRecord *record = m_helper->findWindow(w);
+    if (!record) return;
+
+    if(record->isManaged) {
+        QRectF maximized_area = effects->clientArea(MaximizeArea, w);
+        record->skipEffect = maximized_area == w->frameGeometry() && m_disabledForMaximized;
+    }
+
+    updatePaintState(w);
 }
 
 void
-LightlyShadersEffect::windowAdded(EffectWindow *w)
+LightlyShadersEffect::updatePaintState(EffectWindow *w)
 {
-    m_windows[w].isManaged = false;
+    LSWindowRecord *record = m_helper->findWindow(w);
+    if (!record) return;
+
+    LSWindowRecord::PaintState state;
+    if (!record->isManaged) {
+        state = LSWindowRecord::Unshaded;
+    } else if (w->isFullScreen() || record->skipEffect) {
+        state = LSWindowRecord::Suspended;
+    } else if (m_renderMode == LSHelper::CornersOnly && m_cornerRenderer->isValid()) {
+        // Drawn straight to the render target, see drawCornersOnly()
+        state = LSWindowRecord::Direct;
+    } else {
+        state = LSWindowRecord::Offscreen;
+    }
 
-    if(!m_helper->isManagedWindow(w))
-        return;
+    if (state == record->paintState) return;
+
+    // Leaving the offscreen path frees the window's offscreen texture, so
+    // fullscreen and maximized windows cost nothing and can be scanned out.
+    // Entering it redirects the window only once it's painted.
+    if (record->paintState == LSWindowRecord::Offscreen) {
+        releaseOffscreen(w, record);
+    }
+    record->paintState = state;
+}
+
+void
+LightlyShadersEffect::releaseOffscreen(EffectWindow *w, LSWindowRecord *record)
+{
+    if (!record->redirected) return;
 
-    m_windows[w].isManaged = true;
-    m_windows[w].skipEffect = false;
+    unredirect(w);
+    record->redirected = false;
+    releaseShadowTiles(w);
+    m_redirected.removeOne(w);
+}
 
-    connect(effects, &EffectsHandler::windowMaximizedStateChanged,
-            this, &LightlyShadersEffect::windowMaximizedStateChanged);
-    connect(effects, &EffectsHandler::windowFullScreenChanged,
-            this, &LightlyShadersEffect::windowFullScreenChanged);
+void
+LightlyShadersEffect::invalidateShadowTiles(EffectWindow *w)
+{
+    auto it = m_shadowTiles.find(w);
+    if (it != m_shadowTiles.end()) {
+        it->second->invalidate();
+    }
+}
 
-    QRectF maximized_area = effects->clientArea(MaximizeArea, w);
-    if (maximized_area == w->frameGeometry() && m_disabledForMaximized)
-        m_windows[w].skipEffect = true;
+void
+LightlyShadersEffect::releaseShadowTiles(EffectWindow *w)
+{
+    auto it = m_shadowTiles.find(w);
+    if (it == m_shadowTiles.end()) return;
 
-    redirect(w);
-    setShader(w, m_shader.get());
+    // Also called from signals outside of painting, the tiles free their
+    // texture and framebuffer
+    effects->makeOpenGLContextCurrent();
+    m_shadowTiles.erase(it);
 }
 
 void
-LightlyShadersEffect::windowFullScreenChanged(EffectWindow *w)
+LightlyShadersEffect::postPaintScreen()
 {
-    if(w->isFullScreen()) {
-        m_windows[w].isManaged = false;
-    } else {
-        m_windows[w].isManaged = true;
+    effects->postPaintScreen();
+
+    // Each output repaints at its own rate, so a window only ages with the
+    // frames of the output it was last painted on
+    ++m_frameCounts[m_paintedScreen];
+
+    // Release windows that were not painted for a while, then the least
+    // recently painted ones until the estimate fits the budget
+    qint64 total = 0;
+    QVector<std::pair<quint64, EffectWindow *>> candidates;
+    QVector<EffectWindow *> idle;
+    for (EffectWindow *w : qAsConst(m_redirected)) {
+        const LSWindowRecord *record = m_helper->findWindow(w);
+        if (!record) continue;
+
+        // Windows last painted on a removed output are idle
+        const auto frameCount = m_frameCounts.find(record->lastPaintScreen);
+        const quint64 idleFrames = frameCount != m_frameCounts.end() ? frameCount->second - record->lastPaintFrame : std::numeric_limits<quint64>::max();
+        if (idleFrames > quint64(m_offscreenIdleFrames)) {
+            idle.append(w);
+            continue;
+        }
+
+        total += offscreenSize(w);
+        if (idleFrames > 1) {
+            candidates.append({idleFrames, w});
+        }
     }
+
+    const qint64 budget = qint64(m_offscreenBudget) * 1024 * 1024;
+    if (budget > 0 && total > budget) {
+        std::sort(candidates.begin(), candidates.end(), std::greater<>());
+        for (const auto &candidate : qAsConst(candidates)) {
+            if (total <= budget) break;
+            total -= offscreenSize(candidate.second);
+            idle.append(candidate.second);
+        }
+    }
+
+    for (EffectWindow *w : qAsConst(idle)) {
+        if (LSWindowRecord *record = m_helper->findWindow(w)) {
+            releaseOffscreen(w, record);
+        }
+    }
+
+    // Windows drawn without their program are drawn again once it's built
+    if (m_shader->isBuilding() || m_cornerRenderer->isBuilding()) {
+        effects->addRepaintFull();
+    }
+}
+
+qint64
+LightlyShadersEffect::offscreenSize(EffectWindow *w) const
+{
+    // The offscreen texture covers the expanded geometry in device pixels
+    const qreal scale = w->screen() ? w->screen()->devicePixelRatio() : 1.0;
+    const QSizeF size = w->expandedGeometry().size() * scale;
+    return qint64(size.width()) * qint64(size.height()) * 4;
+}
+
+void
+LightlyShadersEffect::windowFullScreenChanged(EffectWindow *w)
+{
+    updatePaintState(w);
 }
 
 void
 LightlyShadersEffect::windowMaximizedStateChanged(EffectWindow *w, bool horizontal, bool vertical)
 {
-    if (!m_disabledForMaximized) return;
+    LSWindowRecord *record = m_helper->findWindow(w);
+    if (!record) return;
 
-    if ((horizontal == true) && (vertical == true)) {
-        m_windows[w].skipEffect = true;
-    } else {
-        m_windows[w].skipEffect = false;
+    record->skipEffect = m_disabledForMaximized && horizontal && vertical;
+    updatePaintState(w);
+}
+
+void
+LightlyShadersEffect::screenAdded(EffectScreen *s)
+{
+    connect(s, &EffectScreen::changed, this, [this, s]() {
+        updateScreen(s);
+    });
+    updateScreen(s);
+}
+
+void
+LightlyShadersEffect::screenRemoved(EffectScreen *s)
+{
+    disconnect(s, nullptr, this, nullptr);
+    m_screens.erase(s);
+    m_frameCounts.erase(s);
+}
+
+void
+LightlyShadersEffect::updateScreen(EffectScreen *s)
+{
+    LSScreenStruct &screen = m_screens[s];
+    const qreal scale = s->devicePixelRatio();
+
+    if (scale != screen.scale) {
+        // Cached window geometry is scaled for the output it was painted on
+        invalidateGeometry();
     }
+
+    screen.scale = scale;
+    screen.sizeScaled = float(m_size*scale);
+    screen.shadowOffsetScaled = float(m_shadowOffset*scale);
+    screen.innerOutlineWidthScaled = float(m_innerOutlineWidth*scale);
+    screen.outerOutlineWidthScaled = float(m_outerOutlineWidth*scale);
+    // As far out of the corners as the shader looks, with a pixel to spare
+    // for filtering
+    screen.shadowTileSize = int(std::ceil(screen.sizeScaled + qMax(screen.shadowOffsetScaled, screen.outerOutlineWidthScaled))) + 1;
 }
 
 void
-LightlyShadersEffect::setRoundness(const int r, EffectScreen *s)
+LightlyShadersEffect::invalidateGeometry()
+{
+    const auto stackingOrder = effects->stackingOrder();
+    for (EffectWindow *w : stackingOrder) {
+        if (LSWindowRecord *record = m_helper->findWindow(w)) {
+            record->geometryValid = false;
+        }
+    }
+}
+
+const LightlyShadersEffect::LSScreenStruct &
+LightlyShadersEffect::screenState(EffectScreen *s) const
 {
-    m_size = r;
-    m_screens[s].sizeScaled = float(r)*m_screens[s].scale;
-    m_corner = QSize(m_size+(m_shadowOffset-1), m_size+(m_shadowOffset-1));
+    // Windows can briefly be on no output while outputs are unplugged
+    static const LSScreenStruct fallback;
+    const auto it = m_screens.find(s);
+    return it != m_screens.end() ? it->second : fallback;
 }
 
 void
@@ -149,44 +347,77 @@ LightlyShadersEffect::reconfigure(ReconfigureFlags flags)
 {
     Q_UNUSED(flags)
 
-    LightlyShadersConfig::self()->load();
+    m_helper->reconfigure();
 
-    m_innerOutlineWidth = LightlyShadersConfig::innerOutlineWidth();
-    m_outerOutlineWidth = LightlyShadersConfig::outerOutlineWidth();
-    m_innerOutline = LightlyShadersConfig::innerOutline();
-    m_outerOutline = LightlyShadersConfig::outerOutline();
-    m_innerOutlineColor = LightlyShadersConfig::innerOutlineColor();
-    m_outerOutlineColor = LightlyShadersConfig::outerOutlineColor();
-    m_disabledForMaximized = LightlyShadersConfig::disabledForMaximized();
-    m_shadowOffset = LightlyShadersConfig::shadowOffset();
-    m_squircleRatio = LightlyShadersConfig::squircleRatio();
-    m_cornersType = LightlyShadersConfig::cornersType();
+    // The helper holds the settings loaded from disk, diff them against
+    // what this effect applied last time
+    const LSConfig &config = m_helper->config();
+    const LSConfig::Changes changes = m_configured ? config.diff(m_config) : LSConfig::AllChanged;
+    m_configured = true;
+    m_config = config;
 
-    m_helper->reconfigure();
-    m_roundness = m_helper->roundness();
+    if (changes == LSConfig::NoChange)
+        return;
 
-    if(m_shadowOffset>=m_roundness) {
-        m_shadowOffset = m_roundness-1;
+    if (changes & LSConfig::OutlineChanged) {
+        m_innerOutline = config.innerOutline;
+        m_outerOutline = config.outerOutline;
+        m_innerOutlineColor = config.innerOutlineColor;
+        m_outerOutlineColor = config.outerOutlineColor;
+        m_innerOutlineWidth = m_innerOutline ? config.innerOutlineWidth : 0;
+        m_outerOutlineWidth = m_outerOutline ? config.outerOutlineWidth : 0;
     }
 
-    if(!m_innerOutline) {
-        m_innerOutlineWidth = 0.0;
+    m_disabledForMaximized = config.disabledForMaximized;
+    m_renderMode = config.renderMode;
+    m_offscreenIdleFrames = config.offscreenIdleFrames;
+    m_offscreenBudget = config.offscreenBudget;
+
+    // Windows are only known once the shaders exist, see the constructor
+    if ((changes & (LSConfig::RenderModeChanged | LSConfig::ClassificationChanged | LSConfig::MaximizedChanged)) && m_shader) {
+        const auto stackingOrder = effects->stackingOrder();
+        for (EffectWindow *w : stackingOrder) {
+            LSWindowRecord *record = m_helper->findWindow(w);
+            if (!record) continue;
+
+            if (changes & LSConfig::MaximizedChanged) {
+                record->skipEffect = m_disabledForMaximized && effects->clientArea(MaximizeArea, w) == w->frameGeometry();
+            }
+            updatePaintState(w);
+        }
     }
-    if(!m_outerOutline) {
-        m_outerOutlineWidth = 0.0;
+
+    if (changes & LSConfig::GeometryChanged) {
+        m_squircleRatio = config.squircleRatio;
+        m_cornersType = config.cornersType;
+        m_roundness = m_helper->roundness();
+
+        m_shadowOffset = config.shadowOffset;
+        if(m_shadowOffset>=m_roundness) {
+            m_shadowOffset = m_roundness-1;
+        }
+
+        m_size = m_roundness;
     }
 
-    const auto screens = effects->screens();
-    for(EffectScreen *s : screens)
-    {
-        if (effects->waylandDisplay() == nullptr) {
-            s = nullptr;
+    if (changes & (LSConfig::GeometryChanged | LSConfig::OutlineChanged)) {
+        for (auto &screen : m_screens) {
+            updateScreen(screen.first);
         }
-        setRoundness(m_roundness, s);
 
-        if (effects->waylandDisplay() == nullptr) {
-            break;
+        m_shaderVariant = 0;
+        if (m_cornersType == LSHelper::SquircledCorners) {
+            m_shaderVariant |= LSShader::Squircle;
+        }
+        if (m_innerOutline) {
+            m_shaderVariant |= LSShader::InnerOutline;
         }
+        if (m_outerOutline) {
+            m_shaderVariant |= LSShader::OuterOutline;
+        }
+
+        // The window slices depend on the corner size and outlines
+        invalidateGeometry();
     }
 
     effects->addRepaintFull();
@@ -195,80 +426,150 @@ LightlyShadersEffect::reconfigure(ReconfigureFlags flags)
 void
 LightlyShadersEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
-    EffectScreen *s = data.screen();
-    if (effects->waylandDisplay() == nullptr) {
-        s = nullptr;
-    }
+    // Programs built since the last frame are used from this one on
+    prepareShaders();
+    m_shader->poll();
+    m_cornerRenderer->poll();
 
-    bool set_roundness = false;
+    m_paintedScreen = data.screen();
+    m_frameTimer->begin();
+    effects->paintScreen(mask, region, data);
+    m_frameTimer->end(m_renderMode == LSHelper::CornersOnly ? QStringLiteral("Corners only") : QStringLiteral("Whole window offscreen"));
 
-    if (!m_screens[s].configured) {
-        m_screens[s].configured = true;
-        set_roundness = true;
+    if (m_loadTimer.isValid()) {
+        reportLoadTime();
     }
+}
 
-    qreal scale = effects->renderTargetScale();
+void
+LightlyShadersEffect::prepareShaders()
+{
+    // Every variant the config selects starts building at once, instead
+    // of each after the window that needs it was painted
+    m_shader->setSquircleRatio(m_squircleRatio);
+    m_shader->prepare(m_shaderVariant);
+    m_shader->prepare(m_shaderVariant | LSShader::Shadow);
+    m_shader->prepare(LSShader::Shadow | LSShader::BakeShadow);
+}
 
-    if(scale != m_screens[s].scale) {
-        m_screens[s].scale = scale;
-        set_roundness = true;
+// How long after the constructor the first frame was painted, and the
+// first one with all programs the config needs
+void
+LightlyShadersEffect::reportLoadTime()
+{
+    const qreal elapsed = m_loadTimer.nsecsElapsed() / 1e6;
+    const bool building = m_shader->isBuilding() || m_cornerRenderer->isBuilding();
+    if (!m_firstFramePainted) {
+        m_firstFramePainted = true;
+        qCDebug(LIGHTLYSHADERS) << "First frame" << elapsed << "ms after loading, shaders building:" << building;
     }
-
-    if(set_roundness) {
-        setRoundness(m_roundness, s);
-        m_helper->reconfigure();
+    if (building) {
+        return;
     }
 
-    effects->paintScreen(mask, region, data);
+    qCDebug(LIGHTLYSHADERS) << "Shaders built" << elapsed << "ms after loading";
+    m_loadTimer.invalidate();
+
+    if (!m_shader->isValid()) {
+        qCWarning(LIGHTLYSHADERS) << "LightlyShaders: no valid shaders found! LightlyShaders will not work.";
+    }
+    // Windows drawn directly move to the offscreen path
+    if (!m_cornerRenderer->isValid()) {
+        const auto stackingOrder = effects->stackingOrder();
+        for (EffectWindow *w : stackingOrder) {
+            updatePaintState(w);
+        }
+    }
 }
 
 void
-LightlyShadersEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds time)
+LightlyShadersEffect::updateGeometry(EffectWindow *w, LSWindowRecord *record)
 {
-    if (!isValidWindow(w) )
-    {
-        effects->prePaintWindow(w, data, time);
+    const LSScreenStruct &screen = screenState(w->screen());
+
+    const QRectF exp_geo(w->expandedGeometry());
+    if (record->geometryValid && record->geometryScale == screen.scale && record->geometryExpanded == exp_geo) {
         return;
     }
 
-    EffectScreen *s = w->screen();
-    if (effects->waylandDisplay() == nullptr) {
-        s = nullptr;
+    const QRectF geo(w->frameGeometry());
+    record->geometryValid = true;
+    record->geometryScale = screen.scale;
+    record->geometryExpanded = exp_geo;
+    record->scaledFrame = scale(geo, screen.scale);
+    record->scaledExpanded = scale(exp_geo, screen.scale);
+    record->shapes->cornerExclusion = QRegion();
+
+    auto tiles = m_shadowTiles.find(w);
+    if (tiles != m_shadowTiles.end()) {
+        tiles->second->invalidate();
     }
 
-    const QRectF geo(w->frameGeometry());
+    // Where the corner shader can change pixels, with a pixel to spare for
+    // rounding to device pixels
+    const bool shadow = exp_geo != geo;
+    LSWindowSlices::Insets insets;
+    insets.radius = m_size + 1;
+    if (shadow) {
+        insets.inside = (m_innerOutline ? m_innerOutlineWidth : 0) + 1;
+        insets.outside = qMax(m_shadowOffset, m_outerOutline ? m_outerOutlineWidth : 0) + 1;
+    } else if (m_innerOutline || m_outerOutline) {
+        insets.inside = m_outerOutlineWidth + (m_innerOutline ? m_innerOutlineWidth : 0) + 1;
+    }
+    LSWindowSlices::split(geo.size(), exp_geo.translated(-geo.topLeft()), insets,
+                          &record->shapes->shadedSlices, &record->shapes->plainSlices);
+
+    const LSHelper::MaskSet masks = m_helper->maskSet(w->screen());
+    // The set may still be the one from before a config change
+    const int size = masks.key.radius;
+    const QRect frame = geo.toRect();
     for (int corner = 0; corner < LSHelper::NTex; ++corner)
     {
-        QRegion reg = QRegion(scale(m_helper->m_maskRegions[corner]->boundingRect(), m_screens[s].scale).toRect());
+        QRegion reg = masks.translucentRegions[corner];
         switch(corner) {
             case LSHelper::TopLeft:
-                reg.translate(geo.x()-m_shadowOffset, geo.y()-m_shadowOffset);
+                reg.translate(frame.x(), frame.y());
                 break;
             case LSHelper::TopRight:
-                reg.translate(geo.x() + geo.width() - m_size, geo.y()-m_shadowOffset);
+                reg.translate(frame.x() + frame.width() - size, frame.y());
                 break;
             case LSHelper::BottomRight:
-                reg.translate(geo.x() + geo.width() - m_size-1, geo.y()+geo.height()-m_size-1);
+                reg.translate(frame.x() + frame.width() - size, frame.y() + frame.height() - size);
                 break;
             case LSHelper::BottomLeft:
-                reg.translate(geo.x()-m_shadowOffset+1, geo.y()+geo.height()-m_size-1);
+                reg.translate(frame.x(), frame.y() + frame.height() - size);
                 break;
             default:
                 break;
         }
 
-        data.opaque -= reg;
+        record->shapes->cornerExclusion += reg;
+    }
+}
+
+void
+LightlyShadersEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds time)
+{
+    if (!isValidWindow(w) )
+    {
+        effects->prePaintWindow(w, data, time);
+        return;
     }
 
+    LSWindowRecord *record = m_helper->findWindow(w);
+    updateGeometry(w, record);
+    data.opaque -= record->shapes->cornerExclusion;
+
     effects->prePaintWindow(w, data, time);
 }
 
 bool
 LightlyShadersEffect::isValidWindow(EffectWindow *w)
 {
+    const LSWindowRecord *record = m_helper->findWindow(w);
     if (!m_shader->isValid()
-            || !m_windows[w].isManaged
-            || m_windows[w].skipEffect
+            || !record
+            || (record->paintState != LSWindowRecord::Offscreen && record->paintState != LSWindowRecord::Direct)
         )
     {
         return false;
@@ -276,6 +577,37 @@ LightlyShadersEffect::isValidWindow(EffectWindow *w)
     return true;
 }
 
+bool
+LightlyShadersEffect::blocksDirectScanout() const
+{
+    // Only a fullscreen window can be scanned out, and not while it's
+    // redirected. updatePaintState() unredirects windows going fullscreen,
+    // this keeps scanout off should one still be redirected.
+    for (EffectWindow *w : qAsConst(m_redirected)) {
+        if (w->isFullScreen()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Where the corner squares of the shadow tiles start in the window
+// texture, in device pixels with y up. Whole pixels, so the tiles map 1:1
+// to the texture. Each square reaches from inside of the corner radius to
+// beyond the shadow sample offset and outer outline.
+static QVector4D
+shadowTileOrigins(const LSWindowRecord *record, qreal radius, int tile)
+{
+    const QRectF &frame = record->scaledFrame;
+    const QRectF &expanded = record->scaledExpanded;
+    const qreal left = frame.x() - expanded.x();
+    const qreal bottom = expanded.bottom() - frame.bottom();
+    return QVector4D(std::ceil(left + radius) - tile,
+                     std::floor(left + frame.width() - radius),
+                     std::ceil(bottom + radius) - tile,
+                     std::floor(bottom + frame.height() - radius));
+}
+
 void
 LightlyShadersEffect::drawWindow(EffectWindow* w, int mask, const QRegion& region, WindowPaintData& data)
 {
@@ -287,54 +619,222 @@ LightlyShadersEffect::drawWindow(EffectWindow* w, int mask, const QRegion& regio
         return;
     }
 
-    EffectScreen *s = w->screen();
-    if (effects->waylandDisplay() == nullptr) {
-        s = nullptr;
+    LSWindowRecord *record = m_helper->findWindow(w);
+    if (record->paintState == LSWindowRecord::Direct) {
+        drawCornersOnly(w, mask, region, data);
+        return;
     }
 
-    QRectF geo(w->frameGeometry());
-    QRectF exp_geo(w->expandedGeometry());
+    updateGeometry(w, record);
 
-    const QRectF geo_scaled = scale(geo, m_screens[s].scale);
-    const QRectF exp_geo_scaled = scale(exp_geo, m_screens[s].scale);
+    // The variant follows the config and whether the window has a shadow
+    uint variant = m_shaderVariant;
+    if (record->scaledExpanded != record->scaledFrame) {
+        variant |= LSShader::Shadow;
+    }
+    // Selected once the shadow tiles are baked, which selects their own
+    // variant. The squircle ratio is passed on in prepareShaders().
+    if (!m_shader->isReady(variant)) {
+        effects->drawWindow(w, mask, region, data);
+        return;
+    }
+
+    // Windows are redirected when they are painted for the first time
+    record->lastPaintScreen = m_paintedScreen;
+    record->lastPaintFrame = m_frameCounts[m_paintedScreen];
+    if (!record->redirected) {
+        redirect(w);
+        record->redirected = true;
+        m_redirected.append(w);
+    }
+
+    // Slices outside of the repaint are dropped, unless the window is
+    // transformed and the frame position says nothing about where it lands
+    QVector<QRectF> shaded, plain;
+    if (mask & PAINT_WINDOW_TRANSFORMED) {
+        shaded = record->shapes->shadedSlices;
+        plain = record->shapes->plainSlices;
+    } else {
+        const QPointF origin = w->frameGeometry().topLeft();
+        auto cull = [&](const QVector<QRectF> &slices, QVector<QRectF> &out) {
+            for (const QRectF &slice : slices) {
+                const QRectF target = slice.translated(origin);
+                if (screen.intersects(target) && region.intersects(target.toAlignedRect())) {
+                    out.append(slice);
+                }
+            }
+        };
+        cull(record->shapes->shadedSlices, shaded);
+        cull(record->shapes->plainSlices, plain);
+    }
 
     //Draw rounded corners with shadows
-    const int frameSizeLocation = m_shader->uniformLocation("frame_size");
-    const int expandedSizeLocation = m_shader->uniformLocation("expanded_size");
-    const int shadowSizeLocation = m_shader->uniformLocation("shadow_size");
-    const int radiusLocation = m_shader->uniformLocation("radius");
-    const int shadowOffsetLocation = m_shader->uniformLocation("shadow_sample_offset");
-    const int innerOutlineColorLocation = m_shader->uniformLocation("inner_outline_color");
-    const int outerOutlineColorLocation = m_shader->uniformLocation("outer_outline_color");
-    const int innerOutlineWidthLocation = m_shader->uniformLocation("inner_outline_width");
-    const int outerOutlineWidthLocation = m_shader->uniformLocation("outer_outline_width");
-    const int drawInnerOutlineLocation = m_shader->uniformLocation("draw_inner_outline");
-    const int drawOuterOutlineLocation = m_shader->uniformLocation("draw_outer_outline");
-    const int squircleRatioLocation = m_shader->uniformLocation("squircle_ratio");
-    const int isSquircleLocation = m_shader->uniformLocation("is_squircle");
+    if (!shaded.isEmpty()) {
+        const LSScreenStruct &output = screenState(w->screen());
+        if (variant & LSShader::Shadow) {
+            LSShadowTiles *tiles = bakeShadowTiles(w, record, mask, output);
+            if (!tiles) {
+                effects->drawWindow(w, mask, region, data);
+                return;
+            }
+            glActiveTexture(GL_TEXTURE2);
+            tiles->texture()->bind();
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        GLShader *shader = m_shader->select(variant);
+        ShaderManager *sm = ShaderManager::instance();
+        sm->pushShader(shader);
+
+        // Only values that differ from the previous draw are uploaded
+        m_shader->setGeometry(record->scaledFrame, record->scaledExpanded);
+        m_shader->setCorners(output.sizeScaled, output.shadowOffsetScaled);
+        m_shader->setOutlines(m_innerOutlineColor, output.innerOutlineWidthScaled,
+                              m_outerOutlineColor, output.outerOutlineWidthScaled);
+        m_shader->setShadowTiles(output.shadowTileSize, shadowTileOrigins(record, output.sizeScaled, output.shadowTileSize));
+
+        glActiveTexture(GL_TEXTURE0);
+
+        m_slices = shaded;
+        setShader(w, shader);
+        OffscreenEffect::drawWindow(w, mask, region, data);
+
+        sm->popShader();
+    }
+
+    // The interior goes through the default texture shader
+    if (!plain.isEmpty()) {
+        m_slices = plain;
+        setShader(w, nullptr);
+        OffscreenEffect::drawWindow(w, mask, region, data);
+    }
+
+    m_slices.clear();
+}
+
+/*
+ * The shadow behind the corners only depends on the shadow next to the
+ * frame, so it is baked once per window through the offscreen texture.
+ * Each corner square is drawn where it lies in the window, relative to the
+ * frame in device pixels with y down, and moved into its quarter of the
+ * tiles, which are y up like the window texture.
+ */
+LSShadowTiles *
+LightlyShadersEffect::bakeShadowTiles(EffectWindow *w, LSWindowRecord *record, int mask, const LSScreenStruct &output)
+{
+    const int tile = output.shadowTileSize;
+    std::unique_ptr<LSShadowTiles> &tiles = m_shadowTiles[w];
+    if (!tiles) {
+        tiles = std::make_unique<LSShadowTiles>();
+    }
+    if (tiles->isBaked(tile)) {
+        return tiles.get();
+    }
+
+    GLShader *shader = m_shader->select(LSShader::Shadow | LSShader::BakeShadow);
+    if (!shader || !tiles->beginBake(tile)) {
+        return nullptr;
+    }
+
     ShaderManager *sm = ShaderManager::instance();
-    sm->pushShader(m_shader.get());
-
-    //qCWarning(LIGHTLYSHADERS) << geo_scaled.width() << geo_scaled.height();
-    m_shader->setUniform(frameSizeLocation, QVector2D(geo_scaled.width(), geo_scaled.height()));
-    m_shader->setUniform(expandedSizeLocation, QVector2D(exp_geo_scaled.width(), exp_geo_scaled.height()));
-    m_shader->setUniform(shadowSizeLocation, QVector3D(geo_scaled.x() - exp_geo_scaled.x(), geo_scaled.y()-exp_geo_scaled.y(), exp_geo_scaled.height() - geo_scaled.height() - geo_scaled.y() + exp_geo_scaled.y() ));
-    m_shader->setUniform(radiusLocation, m_screens[s].sizeScaled);
-    m_shader->setUniform(shadowOffsetLocation, float(m_shadowOffset*m_screens[s].scale));
-    m_shader->setUniform(innerOutlineColorLocation, QVector4D(m_innerOutlineColor.red()/255.0,m_innerOutlineColor.green()/255.0,m_innerOutlineColor.blue()/255.0,m_innerOutlineColor.alpha()/255.0));
-    m_shader->setUniform(outerOutlineColorLocation, QVector4D(m_outerOutlineColor.red()/255.0,m_outerOutlineColor.green()/255.0,m_outerOutlineColor.blue()/255.0,m_outerOutlineColor.alpha()/255.0));
-    m_shader->setUniform(innerOutlineWidthLocation, float(m_innerOutlineWidth*m_screens[s].scale));
-    m_shader->setUniform(outerOutlineWidthLocation, float(m_outerOutlineWidth*m_screens[s].scale));
-    m_shader->setUniform(drawInnerOutlineLocation, m_innerOutline);
-    m_shader->setUniform(drawOuterOutlineLocation, m_outerOutline);
-    m_shader->setUniform(squircleRatioLocation, m_squircleRatio);
-    m_shader->setUniform(isSquircleLocation, (m_cornersType == LSHelper::SquircledCorners));
-
-    glActiveTexture(GL_TEXTURE0);
-
-    OffscreenEffect::drawWindow(w, mask, region, data);
+    sm->pushShader(shader);
+    m_shader->setGeometry(record->scaledFrame, record->scaledExpanded);
+    m_shader->setCorners(output.sizeScaled, output.shadowOffsetScaled);
+    setShader(w, shader);
+
+    // The offscreen effect moves the window to its rounded device position
+    const qreal renderScale = effects->renderTargetScale();
+    const QPointF windowOffset(std::round(w->x() * renderScale), std::round(w->y() * renderScale));
+
+    // From the frame, y down, to the window texture, y up
+    const QRectF &frame = record->scaledFrame;
+    const qreal left = frame.x() - record->scaledExpanded.x();
+    const qreal top = record->scaledExpanded.bottom() - frame.y();
+    const QVector4D origins = shadowTileOrigins(record, output.sizeScaled, tile);
+
+    for (int corner = 0; corner < 4; ++corner) {
+        const int right = corner == 1 || corner == 2;
+        const int upper = corner < 2;
+        const qreal x = right ? origins.y() : origins.x();
+        const qreal y = upper ? origins.w() : origins.z();
+        const QRectF device(x - left, top - y - tile, tile, tile);
+
+        QMatrix4x4 projection;
+        projection.ortho(0, 2 * tile, 0, 2 * tile, -1, 1);
+        projection.translate(left - x + right * tile, top - y + upper * tile);
+        projection.scale(1, -1);
+        projection.translate(-windowOffset.x(), -windowOffset.y());
+
+        WindowPaintData bakeData;
+        bakeData.setProjectionMatrix(projection);
+        m_slices = {QRectF(device.topLeft() / output.scale, device.size() / output.scale)};
+        OffscreenEffect::drawWindow(w, mask, infiniteRegion(), bakeData);
+    }
 
+    m_slices.clear();
     sm->popShader();
+    tiles->endBake();
+    return tiles.get();
+}
+
+void
+LightlyShadersEffect::apply(EffectWindow *window, int mask, WindowPaintData &data, WindowQuadList &quads)
+{
+    Q_UNUSED(window)
+    Q_UNUSED(mask)
+    Q_UNUSED(data)
+
+    // The offscreen texture comes as one quad over the expanded geometry,
+    // relative to the frame, which is cut down to the slices being drawn
+    if (m_slices.isEmpty() || quads.count() != 1) {
+        return;
+    }
+
+    const WindowQuad quad = quads.first();
+    const QRectF bounds(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
+    quads.clear();
+    for (const QRectF &slice : std::as_const(m_slices)) {
+        const QRectF clipped = slice & bounds;
+        if (!clipped.isEmpty()) {
+            quads.append(quad.makeSubQuad(clipped.left(), clipped.top(), clipped.right(), clipped.bottom()));
+        }
+    }
+}
+
+void
+LightlyShadersEffect::drawCornersOnly(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
+{
+    // Rotated windows are left square
+    if (data.rotationAngle() != 0.0) {
+        effects->drawWindow(w, mask, region, data);
+        return;
+    }
+
+    QRectF frame(w->frameGeometry());
+    qreal scale = 1.0;
+    if (mask & PAINT_WINDOW_TRANSFORMED) {
+        frame = QRectF(frame.topLeft() + QPointF(data.xTranslation(), data.yTranslation()),
+                       QSizeF(frame.width() * data.xScale(), frame.height() * data.yScale()));
+        scale = data.xScale();
+    }
+
+    LSCornerRenderer::Corners corners;
+    corners.frame = frame;
+    corners.radius = m_size * scale;
+    corners.shadowOffset = m_shadowOffset * scale;
+    corners.hasShadow = w->expandedGeometry() != w->frameGeometry();
+    corners.squircle = m_cornersType == LSHelper::SquircledCorners;
+    corners.squircleRatio = m_squircleRatio;
+    corners.innerOutline = m_innerOutline;
+    corners.innerOutlineWidth = m_innerOutlineWidth * scale;
+    corners.innerOutlineColor = m_innerOutlineColor;
+    corners.outerOutline = m_outerOutline;
+    corners.outerOutlineWidth = m_outerOutlineWidth * scale;
+    corners.outerOutlineColor = m_outerOutlineColor;
+
+    m_cornerRenderer->begin(corners, region);
+    effects->drawWindow(w, mask, region, data);
+    m_cornerRenderer->end(data.screenProjectionMatrix());
 }
 
 QRectF
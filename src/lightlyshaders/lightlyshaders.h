@@ -22,7 +22,14 @@
 
 #include <kwinoffscreeneffect.h>
 
+#include <QElapsedTimer>
+
 #include "lshelper.h"
+#include "lscornerrenderer.h"
+#include "lsframetimer.h"
+#include "lsshader.h"
+#include "lsshadowtiles.h"
+#include "lswindowslices.h"
 
 namespace KWin {
 
@@ -38,50 +45,83 @@ public:
     static bool supported();
     static bool enabledByDefault();
 
-    void setRoundness(const int r, EffectScreen *s);
     void reconfigure(ReconfigureFlags flags) override;
     void paintScreen(int mask, const QRegion &region, ScreenPaintData &data) override;
+    void postPaintScreen() override;
     void prePaintWindow(EffectWindow* w, WindowPrePaintData& data, std::chrono::milliseconds time) override;
     void drawWindow(EffectWindow* w, int mask, const QRegion& region, WindowPaintData& data) override;
+    bool blocksDirectScanout() const override;
     virtual int requestedEffectChainPosition() const override { return 99; }
 
+protected:
+    void apply(EffectWindow *window, int mask, WindowPaintData &data, WindowQuadList &quads) override;
+
 protected Q_SLOTS:
     void windowAdded(EffectWindow *window);
-    void windowDeleted(EffectWindow *window);
     void windowMaximizedStateChanged(EffectWindow *window, bool horizontal, bool vertical);
     void windowFullScreenChanged(EffectWindow *window);
+    void screenAdded(EffectScreen *s);
+    void screenRemoved(EffectScreen *s);
 
 private:
     enum { Top = 0, Bottom, NShad };
 
-    struct LSWindowStruct
-    {
-        bool skipEffect;
-        bool isManaged;
-    };
-
+    // Corner geometry of one output, in device pixels
     struct LSScreenStruct
     {
-        bool configured=false;
         qreal scale=1.0;
-        float sizeScaled;
+        float sizeScaled=0.0;
+        float shadowOffsetScaled=0.0;
+        float innerOutlineWidthScaled=0.0;
+        float outerOutlineWidthScaled=0.0;
+        int shadowTileSize=0;
     };
 
     bool isValidWindow(EffectWindow *w);
+    void updatePaintState(EffectWindow *w);
+    void releaseOffscreen(EffectWindow *w, LSWindowRecord *record);
+    void invalidateShadowTiles(EffectWindow *w);
+    void releaseShadowTiles(EffectWindow *w);
+    void updateScreen(EffectScreen *s);
+    void invalidateGeometry();
+    const LSScreenStruct &screenState(EffectScreen *s) const;
+    void updateGeometry(EffectWindow *w, LSWindowRecord *record);
+    void prepareShaders();
+    void reportLoadTime();
+    qint64 offscreenSize(EffectWindow *w) const;
+    LSShadowTiles *bakeShadowTiles(EffectWindow *w, LSWindowRecord *record, int mask, const LSScreenStruct &output);
+    void drawCornersOnly(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data);
 
     void fillRegion(const QRegion &reg, const QColor &c);
     QRectF scale(const QRectF rect, qreal scaleFactor);
 
-    LSHelper *m_helper;
+    QSharedPointer<LSHelper> m_helper;
 
     int m_size, m_innerOutlineWidth, m_outerOutlineWidth, m_roundness, m_shadowOffset, m_squircleRatio, m_cornersType;
     bool m_innerOutline, m_outerOutline, m_darkTheme, m_disabledForMaximized;
     QColor m_innerOutlineColor, m_outerOutlineColor;
-    std::unique_ptr<GLShader> m_shader;
-    QSize m_corner;
+    bool m_configured = false;
+    LSConfig m_config;
+    int m_renderMode = LSHelper::RedirectWindow;
+    int m_offscreenIdleFrames = 0;
+    int m_offscreenBudget = 0;
+    // Frames painted per output, or on all of them at once under X11
+    std::unordered_map<EffectScreen *, quint64> m_frameCounts;
+    EffectScreen *m_paintedScreen = nullptr;
+    QVector<EffectWindow *> m_redirected;
+    std::unique_ptr<LSShader> m_shader;
+    uint m_shaderVariant = 0;
+    // Rects of the window drawWindow is currently drawing, for apply()
+    QVector<QRectF> m_slices;
+    std::unordered_map<EffectWindow *, std::unique_ptr<LSShadowTiles>> m_shadowTiles;
+    EffectWindow *m_activeWindow = nullptr;
+    std::unique_ptr<LSCornerRenderer> m_cornerRenderer;
+    std::unique_ptr<LSFrameTimer> m_frameTimer;
+    // Runs from the constructor until the shaders are built
+    QElapsedTimer m_loadTimer;
+    bool m_firstFramePainted = false;
 
     std::unordered_map<EffectScreen *, LSScreenStruct> m_screens;
-    QMap<EffectWindow *, LSWindowStruct> m_windows;
 };
 
 } // namespace KWin
@@ -0,0 +1,318 @@
+#include "lscornerrenderer.h"
+
+#include <kwineffects.h>
+
+namespace KWin {
+
+LSCornerRenderer::LSCornerRenderer()
+{
+    m_build = std::make_unique<LSProgramBuild>(ShaderTrait::MapTexture, QStringLiteral(""), QStringLiteral(":/effects/lightlyshaders/shaders/lightlyshaders_corners.frag"));
+}
+
+void
+LSCornerRenderer::poll()
+{
+    if (m_build && (m_build->isReady() || !m_build->isParallel())) {
+        finish();
+    }
+}
+
+bool
+LSCornerRenderer::isBuilding() const
+{
+    return m_build != nullptr;
+}
+
+void
+LSCornerRenderer::finish()
+{
+    m_shader = m_build->finish();
+    m_build.reset();
+    if (!isValid()) {
+        return;
+    }
+
+    m_textureSizeLocation = m_shader->uniformLocation("texture_size");
+    m_centerLocation = m_shader->uniformLocation("center");
+    m_shadowStartLocation = m_shader->uniformLocation("shadow_start");
+    m_hasShadowLocation = m_shader->uniformLocation("has_shadow");
+    m_radiusLocation = m_shader->uniformLocation("radius");
+    m_innerOutlineColorLocation = m_shader->uniformLocation("inner_outline_color");
+    m_outerOutlineColorLocation = m_shader->uniformLocation("outer_outline_color");
+    m_innerOutlineWidthLocation = m_shader->uniformLocation("inner_outline_width");
+    m_outerOutlineWidthLocation = m_shader->uniformLocation("outer_outline_width");
+    m_drawInnerOutlineLocation = m_shader->uniformLocation("draw_inner_outline");
+    m_drawOuterOutlineLocation = m_shader->uniformLocation("draw_outer_outline");
+    m_squircleRatioLocation = m_shader->uniformLocation("squircle_ratio");
+    m_isSquircleLocation = m_shader->uniformLocation("is_squircle");
+
+    ShaderBinder binder(m_shader.get());
+    m_shader->setUniform("background_sampler", 0);
+    m_shader->setUniform("window_sampler", 1);
+}
+
+bool
+LSCornerRenderer::isValid() const
+{
+    // The tiles are copied with blits. Valid while the program is building.
+    return GLFramebuffer::blitSupported() && (m_build || (m_shader && m_shader->isValid()));
+}
+
+void
+LSCornerRenderer::ensureTextures(const QSize &size)
+{
+    if (m_textureSize.width() >= size.width() && m_textureSize.height() >= size.height()) {
+        return;
+    }
+
+    // Grow in steps, so windows of slightly different radius share them
+    m_textureSize = QSize((size.width() + 31) & ~31, (size.height() + 31) & ~31).expandedTo(m_textureSize);
+
+    for (int corner = 0; corner < NTex; ++corner) {
+        m_background[corner] = std::make_unique<GLTexture>(GL_RGBA8, m_textureSize);
+        m_background[corner]->setFilter(GL_NEAREST);
+        m_background[corner]->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_backgroundTarget[corner] = std::make_unique<GLFramebuffer>(m_background[corner].get());
+
+        m_window[corner] = std::make_unique<GLTexture>(GL_RGBA8, m_textureSize);
+        m_window[corner]->setFilter(GL_NEAREST);
+        m_window[corner]->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_windowTarget[corner] = std::make_unique<GLFramebuffer>(m_window[corner].get());
+    }
+}
+
+void
+LSCornerRenderer::begin(const Corners &corners, const QRegion &region)
+{
+    m_active = false;
+    if (m_build && m_build->isReady()) {
+        finish();
+    }
+    if (!m_shader || !m_shader->isValid()) {
+        return;
+    }
+
+    m_corners = corners;
+
+    const QRect renderTarget = effects->renderTargetRect();
+    m_scale = effects->renderTargetScale();
+    m_targetOffset = QPointF(renderTarget.topLeft()) * m_scale;
+    const QRect targetRect(QPoint(0, 0), renderTarget.size() * m_scale);
+
+    const QRectF &r = corners.frame;
+    const qreal radius = corners.radius;
+    const qreal offset = corners.hasShadow ? corners.shadowOffset : 0.0;
+    const qreal margin = corners.hasShadow ? qMax(corners.shadowOffset, corners.outerOutline ? corners.outerOutlineWidth : 0.0) : 0.0;
+    const qreal tileSize = radius + margin;
+
+    const QRectF logicalTiles[NTex] = {
+        QRectF(r.left() - margin, r.top() - margin, tileSize, tileSize),
+        QRectF(r.right() - radius, r.top() - margin, tileSize, tileSize),
+        QRectF(r.right() - radius, r.bottom() - radius, tileSize, tileSize),
+        QRectF(r.left() - margin, r.bottom() - radius, tileSize, tileSize),
+    };
+    const QPointF centers[NTex] = {
+        QPointF(r.left() + radius, r.top() + radius),
+        QPointF(r.right() - radius, r.top() + radius),
+        QPointF(r.right() - radius, r.bottom() - radius),
+        QPointF(r.left() + radius, r.bottom() - radius),
+    };
+    const QPointF shadowStarts[NTex] = {
+        QPointF(r.left() - offset, r.top() - offset),
+        QPointF(r.right() + offset, r.top() - offset),
+        QPointF(r.right() + offset, r.bottom() + offset),
+        QPointF(r.left() - offset, r.bottom() + offset),
+    };
+
+    QSize textureSize;
+    for (int corner = 0; corner < NTex; ++corner) {
+        Tile &tile = m_tiles[corner];
+        tile.device = QRect();
+
+        if (!region.intersects(logicalTiles[corner].toAlignedRect())) {
+            continue;
+        }
+
+        tile.device = scaledRect(logicalTiles[corner].translated(-renderTarget.topLeft()), m_scale).toAlignedRect() & targetRect;
+        if (tile.device.isEmpty()) {
+            continue;
+        }
+
+        // Tiles are stored bottom up, so flip y
+        const auto toTile = [&](const QPointF &p) {
+            const QPointF device = (p - renderTarget.topLeft()) * m_scale;
+            return QPointF(device.x() - tile.device.x(), tile.device.y() + tile.device.height() - device.y());
+        };
+        tile.center = toTile(centers[corner]);
+        const QPointF start = toTile(shadowStarts[corner]);
+        tile.shadowStart = QPointF(qBound(0.5, start.x(), tile.device.width() - 0.5), qBound(0.5, start.y(), tile.device.height() - 0.5));
+
+        textureSize = textureSize.expandedTo(tile.device.size());
+        m_active = true;
+    }
+
+    if (!m_active) {
+        return;
+    }
+
+    ensureTextures(textureSize);
+
+    for (int corner = 0; corner < NTex; ++corner) {
+        const QRect &device = m_tiles[corner].device;
+        if (!device.isEmpty()) {
+            m_backgroundTarget[corner]->blitFromFramebuffer(device, QRect(0, m_textureSize.height() - device.height(), device.width(), device.height()));
+        }
+    }
+}
+
+void
+LSCornerRenderer::end(const QMatrix4x4 &projection)
+{
+    if (!m_active) {
+        return;
+    }
+    m_active = false;
+
+    for (int corner = 0; corner < NTex; ++corner) {
+        const QRect &device = m_tiles[corner].device;
+        if (!device.isEmpty()) {
+            m_windowTarget[corner]->blitFromFramebuffer(device, QRect(0, m_textureSize.height() - device.height(), device.width(), device.height()));
+        }
+    }
+
+    // KWin expects its blend function back, not only the enable bit
+    const bool blending = glIsEnabled(GL_BLEND);
+    GLint blendFunc[4];
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendFunc[0]);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendFunc[1]);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendFunc[2]);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendFunc[3]);
+    glDisable(GL_BLEND);
+
+    ShaderManager *sm = ShaderManager::instance();
+    sm->pushShader(m_shader.get());
+
+    const Corners &c = m_corners;
+    m_shader->setUniform(GLShader::ModelViewProjectionMatrix, projection);
+    m_shader->setUniform(m_textureSizeLocation, QVector2D(m_textureSize.width(), m_textureSize.height()));
+    m_shader->setUniform(m_hasShadowLocation, c.hasShadow);
+    m_shader->setUniform(m_radiusLocation, float(c.radius * m_scale));
+    m_shader->setUniform(m_isSquircleLocation, c.squircle);
+    m_shader->setUniform(m_squircleRatioLocation, c.squircleRatio);
+    m_shader->setUniform(m_drawInnerOutlineLocation, c.innerOutline);
+    m_shader->setUniform(m_drawOuterOutlineLocation, c.outerOutline);
+    m_shader->setUniform(m_innerOutlineWidthLocation, float(c.innerOutlineWidth * m_scale));
+    m_shader->setUniform(m_outerOutlineWidthLocation, float(c.outerOutlineWidth * m_scale));
+    m_shader->setUniform(m_innerOutlineColorLocation, QVector4D(c.innerOutlineColor.redF(), c.innerOutlineColor.greenF(), c.innerOutlineColor.blueF(), c.innerOutlineColor.alphaF()));
+    m_shader->setUniform(m_outerOutlineColorLocation, QVector4D(c.outerOutlineColor.redF(), c.outerOutlineColor.greenF(), c.outerOutlineColor.blueF(), c.outerOutlineColor.alphaF()));
+
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    for (int corner = 0; corner < NTex; ++corner) {
+        const Tile &tile = m_tiles[corner];
+        if (tile.device.isEmpty()) {
+            continue;
+        }
+
+        m_shader->setUniform(m_centerLocation, QVector2D(tile.center.x(), tile.center.y()));
+        m_shader->setUniform(m_shadowStartLocation, QVector2D(tile.shadowStart.x(), tile.shadowStart.y()));
+
+        glActiveTexture(GL_TEXTURE1);
+        m_window[corner]->bind();
+        glActiveTexture(GL_TEXTURE0);
+        m_background[corner]->bind();
+
+        // The projection maps device pixels, like the blits
+        const QRectF l = QRectF(tile.device).translated(m_targetOffset);
+        const float s = float(tile.device.width()) / m_textureSize.width();
+        const float t = float(tile.device.height()) / m_textureSize.height();
+        const float vertices[] = {
+            float(l.left()), float(l.top()),
+            float(l.left()), float(l.bottom()),
+            float(l.right()), float(l.bottom()),
+            float(l.left()), float(l.top()),
+            float(l.right()), float(l.bottom()),
+            float(l.right()), float(l.top()),
+        };
+        const float texcoords[] = {
+            0.0f, t,
+            0.0f, 0.0f,
+            s, 0.0f,
+            0.0f, t,
+            s, 0.0f,
+            s, t,
+        };
+        vbo->reset();
+        vbo->setData(6, 2, vertices, texcoords);
+        vbo->render(GL_TRIANGLES);
+    }
+
+    sm->popShader();
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    drawEdgeOutlines(projection);
+
+    glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+    if (!blending) {
+        glDisable(GL_BLEND);
+    }
+}
+
+void
+LSCornerRenderer::drawEdgeOutlines(const QMatrix4x4 &projection)
+{
+    const Corners &c = m_corners;
+    const QRectF &r = c.frame;
+    const qreal radius = c.radius;
+
+    // The straight parts of the outlines between the corner tiles, inset
+    // from the frame edge like in the offscreen shader
+    const auto drawBand = [&](qreal inset, qreal width, const QColor &color) {
+        if (width <= 0 || r.width() <= 2 * radius || r.height() <= 2 * radius) {
+            return;
+        }
+
+        const QRectF bands[] = {
+            QRectF(r.left() + radius, r.top() + inset, r.width() - 2 * radius, width),
+            QRectF(r.left() + radius, r.bottom() - inset - width, r.width() - 2 * radius, width),
+            QRectF(r.left() + inset, r.top() + radius, width, r.height() - 2 * radius),
+            QRectF(r.right() - inset - width, r.top() + radius, width, r.height() - 2 * radius),
+        };
+
+        QVector<float> vertices;
+        vertices.reserve(4 * 12);
+        for (const QRectF &logical : bands) {
+            // In device pixels, like the corner tiles
+            const QRectF band = scaledRect(logical, m_scale);
+            vertices << band.left() << band.top() << band.left() << band.bottom() << band.right() << band.bottom()
+                     << band.left() << band.top() << band.right() << band.bottom() << band.right() << band.top();
+        }
+
+        ShaderBinder binder(ShaderTrait::UniformColor);
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projection);
+        binder.shader()->setUniform(GLShader::Color, color);
+
+        GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+        vbo->reset();
+        vbo->setData(vertices.size() / 2, 2, vertices.constData(), nullptr);
+        vbo->render(GL_TRIANGLES);
+    };
+
+    if (c.hasShadow) {
+        if (c.innerOutline) {
+            drawBand(0, c.innerOutlineWidth, c.innerOutlineColor);
+        }
+        if (c.outerOutline) {
+            drawBand(-c.outerOutlineWidth, c.outerOutlineWidth, c.outerOutlineColor);
+        }
+    } else {
+        if (c.outerOutline) {
+            drawBand(0, c.outerOutlineWidth, c.outerOutlineColor);
+        }
+        if (c.innerOutline) {
+            drawBand(c.outerOutlineWidth, c.innerOutlineWidth, c.innerOutlineColor);
+        }
+    }
+}
+
+} // namespace KWin
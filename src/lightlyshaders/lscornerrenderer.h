@@ -0,0 +1,101 @@
+#ifndef LSCORNERRENDERER_H
+#define LSCORNERRENDERER_H
+
+#include <kwinglutils.h>
+
+#include "lsprogrambuild.h"
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QRectF>
+#include <QRegion>
+
+namespace KWin {
+
+/*
+ * Rounds the corners of a window that is drawn straight to the render
+ * target instead of through an offscreen texture. Before the window is
+ * drawn the background under its corner tiles is copied, afterwards the
+ * tiles are copied again and composited from both copies with the corner
+ * shader. The shadow under a corner is rebuilt from what the shadow next
+ * to it adds to the background. Only the tiles are read and written, not
+ * the whole window.
+ * Windows stay square until the program is built, see LSProgramBuild.
+ */
+class LSCornerRenderer
+{
+public:
+    struct Corners
+    {
+        QRectF frame;        // As painted, in logical pixels
+        qreal radius = 0;    // In logical pixels, scaled like the frame
+        qreal shadowOffset = 0;
+        bool hasShadow = false;
+        bool squircle = false;
+        int squircleRatio = 0;
+        bool innerOutline = false;
+        qreal innerOutlineWidth = 0;
+        QColor innerOutlineColor;
+        bool outerOutline = false;
+        qreal outerOutlineWidth = 0;
+        QColor outerOutlineColor;
+    };
+
+    LSCornerRenderer();
+
+    bool isValid() const;
+    // Finishes the program if it is built, call once per frame
+    void poll();
+    bool isBuilding() const;
+
+    // Call before the window is drawn, tiles outside of region are skipped
+    void begin(const Corners &corners, const QRegion &region);
+    // Call after the window is drawn, projection maps device pixels
+    void end(const QMatrix4x4 &projection);
+
+private:
+    enum { TopLeft = 0, TopRight, BottomRight, BottomLeft, NTex };
+
+    struct Tile
+    {
+        QRect device;   // In the render target, y down
+        QPointF center; // In tile pixels, y up
+        QPointF shadowStart;
+    };
+
+    void finish();
+    void ensureTextures(const QSize &size);
+    void drawEdgeOutlines(const QMatrix4x4 &projection);
+
+    std::unique_ptr<LSProgramBuild> m_build;
+    std::unique_ptr<GLShader> m_shader;
+    int m_textureSizeLocation = -1;
+    int m_centerLocation = -1;
+    int m_shadowStartLocation = -1;
+    int m_hasShadowLocation = -1;
+    int m_radiusLocation = -1;
+    int m_innerOutlineColorLocation = -1;
+    int m_outerOutlineColorLocation = -1;
+    int m_innerOutlineWidthLocation = -1;
+    int m_outerOutlineWidthLocation = -1;
+    int m_drawInnerOutlineLocation = -1;
+    int m_drawOuterOutlineLocation = -1;
+    int m_squircleRatioLocation = -1;
+    int m_isSquircleLocation = -1;
+
+    std::unique_ptr<GLTexture> m_background[NTex];
+    std::unique_ptr<GLFramebuffer> m_backgroundTarget[NTex];
+    std::unique_ptr<GLTexture> m_window[NTex];
+    std::unique_ptr<GLFramebuffer> m_windowTarget[NTex];
+    QSize m_textureSize;
+
+    Corners m_corners;
+    Tile m_tiles[NTex];
+    qreal m_scale = 1.0;
+    QPointF m_targetOffset; // Of the render target, in device pixels
+    bool m_active = false;
+};
+
+} // namespace KWin
+
+#endif //LSCORNERRENDERER_H
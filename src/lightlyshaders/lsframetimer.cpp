@@ -0,0 +1,80 @@
+#include "lsframetimer.h"
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+namespace KWin {
+
+LSFrameTimer::LSFrameTimer(CategoryFunction category)
+    : m_category(category)
+{
+    // Timestamp queries are not part of OpenGL ES
+    m_supported = !GLPlatform::instance()->isGLES()
+        && (hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query")));
+}
+
+LSFrameTimer::~LSFrameTimer()
+{
+    if (m_queries[0][0]) {
+        glDeleteQueries(4, &m_queries[0][0]);
+    }
+}
+
+void
+LSFrameTimer::begin()
+{
+    if (!m_supported || !m_category().isInfoEnabled()) {
+        return;
+    }
+
+    if (!m_queries[0][0]) {
+        glGenQueries(4, &m_queries[0][0]);
+    }
+
+    glQueryCounter(m_queries[m_current][0], GL_TIMESTAMP);
+    m_running = true;
+}
+
+void
+LSFrameTimer::end(const QString &label)
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+
+    glQueryCounter(m_queries[m_current][1], GL_TIMESTAMP);
+    m_pending[m_current] = true;
+    m_current ^= 1;
+
+    // Collect the previous frame, which has most likely finished by now
+    if (m_pending[m_current]) {
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[m_current][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+
+        GLuint64 start = 0;
+        GLuint64 stop = 0;
+        glGetQueryObjectui64v(m_queries[m_current][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(m_queries[m_current][1], GL_QUERY_RESULT, &stop);
+        m_pending[m_current] = false;
+
+        if (label != m_label) {
+            m_label = label;
+            m_total = 0;
+            m_frames = 0;
+        }
+        m_total += stop - start;
+        ++m_frames;
+    }
+
+    if (m_frames >= s_reportInterval) {
+        qCInfo(m_category) << m_label << "average GPU frame time" << (m_total / m_frames) / 1000.0 << "us over" << m_frames << "frames";
+        m_total = 0;
+        m_frames = 0;
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,46 @@
+#ifndef LSFRAMETIMER_H
+#define LSFRAMETIMER_H
+
+#include <epoxy/gl.h>
+
+#include <QLoggingCategory>
+#include <QString>
+
+namespace KWin {
+
+/*
+ * Measures how long the GPU takes to paint each frame with timestamp
+ * queries, and logs the average every few hundred frames, so the render
+ * modes can be compared. Results are read one frame late to not stall.
+ * Only does anything when info output of the category is enabled, which
+ * release builds keep, unlike debug output.
+ */
+class LSFrameTimer
+{
+public:
+    using CategoryFunction = const QLoggingCategory &(*)();
+
+    explicit LSFrameTimer(CategoryFunction category);
+    ~LSFrameTimer();
+
+    void begin();
+    void end(const QString &label);
+
+private:
+    static const int s_reportInterval = 300;
+
+    CategoryFunction m_category;
+    bool m_supported = false;
+    GLuint m_queries[2][2] = {};
+    int m_current = 0;
+    bool m_pending[2] = {false, false};
+    bool m_running = false;
+
+    quint64 m_total = 0;
+    int m_frames = 0;
+    QString m_label;
+};
+
+} // namespace KWin
+
+#endif //LSFRAMETIMER_H
@@ -0,0 +1,336 @@
+#include "lsshader.h"
+
+#include <kwinglplatform.h>
+
+#include <QFile>
+#include <QtMath>
+
+namespace KWin {
+
+static QVector4D
+toVector(const QColor &color)
+{
+    return QVector4D(color.red()/255.0, color.green()/255.0, color.blue()/255.0, color.alpha()/255.0);
+}
+
+LSShader::LSShader()
+{
+    // Same choice of source as ShaderManager::generateShaderFromFile(),
+    // except that GLES 3 gets its own source with reduced precision
+    QString path = QStringLiteral(":/effects/lightlyshaders/shaders/lightlyshaders");
+    GLPlatform *platform = GLPlatform::instance();
+    if (platform->isGLES() && platform->glslVersion() >= kVersionNumber(3, 0)) {
+        path += QStringLiteral("_gles");
+    } else if (!platform->isGLES() && platform->glslVersion() >= kVersionNumber(1, 40)) {
+        path += QStringLiteral("_core");
+    }
+
+    QFile file(path + QStringLiteral(".frag"));
+    if (file.open(QIODevice::ReadOnly)) {
+        m_source = file.readAll();
+    }
+
+    // The plain variant tells whether the shader works at all
+    prepare(0);
+}
+
+LSShader::~LSShader()
+{
+    if (m_squircleRoot) {
+        glDeleteTextures(1, &m_squircleRoot);
+    }
+}
+
+bool
+LSShader::isValid() const
+{
+    // Valid while the plain variant is building
+    const Program &plain = m_programs[0];
+    return !m_source.isEmpty() && (plain.build || (plain.shader && plain.shader->isValid()));
+}
+
+void
+LSShader::setSquircleRatio(int ratio)
+{
+    if (ratio != m_squircleRatio) {
+        m_squircleRatio = ratio;
+        m_squircleRatioChanged = true;
+    }
+}
+
+void
+LSShader::prepare(uint variant)
+{
+    // Squircle variants have the ratio compiled in
+    if (m_squircleRatioChanged) {
+        m_squircleRatioChanged = false;
+        for (uint i = 0; i < NVariants; ++i) {
+            if (i & Squircle) {
+                m_programs[i] = Program();
+            }
+        }
+        updateSquircleRoot();
+    }
+
+    if (!m_programs[variant].started) {
+        compile(variant);
+    }
+}
+
+void
+LSShader::poll()
+{
+    // Without parallel compiling only one variant is built per call
+    bool compiled = false;
+    for (uint i = 0; i < NVariants; ++i) {
+        Program &program = m_programs[i];
+        if (!program.build) {
+            continue;
+        }
+        if (!program.build->isReady()) {
+            if (program.build->isParallel() || compiled) {
+                continue;
+            }
+            compiled = true;
+        }
+        finish(i);
+    }
+}
+
+bool
+LSShader::isBuilding() const
+{
+    for (const Program &program : m_programs) {
+        if (program.build) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+LSShader::isReady(uint variant)
+{
+    prepare(variant);
+
+    Program &program = m_programs[variant];
+    if (program.build && program.build->isReady()) {
+        finish(variant);
+    }
+    return program.shader && program.shader->isValid();
+}
+
+GLShader *
+LSShader::select(uint variant)
+{
+    if (!isReady(variant)) {
+        return nullptr;
+    }
+
+    Program &program = m_programs[variant];
+
+    if (variant & Squircle) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_squircleRoot);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    m_current = &program;
+    return program.shader.get();
+}
+
+// Splits a value in [0, 1] over two bytes
+static void
+encode(char *texel, double value)
+{
+    const double scaled = qBound(0.0, value, 1.0) * 255.0;
+    const int high = qMin(int(scaled), 255);
+    texel[0] = char(high);
+    texel[1] = char(qBound(0, qRound((scaled - high) * 255.0), 255));
+}
+
+/*
+ * (1 + x)^(1/ratio) and its slope at 256 points of [0, 1]. Filtering
+ * unorm textures isn't precise enough on many GPUs, so the shader takes
+ * the nearest point and continues along the slope. The root lies in
+ * [1, sqrt(2)] and the slope in (0, 0.5] for every ratio from 2 up, they
+ * are stored as offset from 1 in units of sqrt(2) - 1 in red and green,
+ * and in units of 0.5 in blue and alpha.
+ */
+void
+LSShader::updateSquircleRoot()
+{
+    if (m_squircleRatio < 2) {
+        return;
+    }
+
+    const double n = m_squircleRatio;
+    QByteArray texels(SquircleRootSize * 4, 0);
+    for (int i = 0; i < SquircleRootSize; ++i) {
+        const double x = 1.0 + double(i) / (SquircleRootSize - 1);
+        encode(texels.data() + i * 4, (qPow(x, 1.0 / n) - 1.0) / (M_SQRT2 - 1.0));
+        encode(texels.data() + i * 4 + 2, qPow(x, 1.0 / n - 1.0) / n / 0.5);
+    }
+
+    if (!m_squircleRoot) {
+        glGenTextures(1, &m_squircleRoot);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_squircleRoot);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SquircleRootSize, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.constData());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void
+LSShader::compile(uint variant)
+{
+    Program &program = m_programs[variant];
+    program.started = true;
+
+    if (m_source.isEmpty()) {
+        return;
+    }
+
+    QByteArray defines;
+    if (variant & Squircle) {
+        defines += "#define LS_SQUIRCLE\n";
+        defines += "#define LS_SQUIRCLE_RATIO " + QByteArray::number(m_squircleRatio) + "\n";
+    }
+    if (variant & InnerOutline) {
+        defines += "#define LS_INNER_OUTLINE\n";
+    }
+    if (variant & OuterOutline) {
+        defines += "#define LS_OUTER_OUTLINE\n";
+    }
+    if (variant & Shadow) {
+        defines += "#define LS_SHADOW\n";
+    }
+    if (variant & BakeShadow) {
+        defines += "#define LS_BAKE_SHADOW\n";
+    }
+
+    if (GLPlatform::instance()->isSoftwareEmulation()) {
+        defines += "#define LS_FULL_PRECISION\n";
+    }
+
+    // Defines have to follow the #version line
+    QByteArray source = m_source;
+    const int versionEnd = source.startsWith("#version") ? source.indexOf('\n') + 1 : 0;
+    source.insert(versionEnd, defines);
+
+    program.build = std::make_unique<LSProgramBuild>(ShaderTrait::MapTexture, QByteArray(), source);
+}
+
+void
+LSShader::finish(uint variant)
+{
+    Program &program = m_programs[variant];
+    program.shader = program.build->finish();
+    program.build.reset();
+    if (!program.shader->isValid()) {
+        return;
+    }
+
+    program.frameSizeLocation = program.shader->uniformLocation("frame_size");
+    program.expandedSizeLocation = program.shader->uniformLocation("expanded_size");
+    program.shadowSizeLocation = program.shader->uniformLocation("shadow_size");
+    program.radiusLocation = program.shader->uniformLocation("radius");
+    program.shadowOffsetLocation = program.shader->uniformLocation("shadow_sample_offset");
+    program.innerOutlineColorLocation = program.shader->uniformLocation("inner_outline_color");
+    program.outerOutlineColorLocation = program.shader->uniformLocation("outer_outline_color");
+    program.innerOutlineWidthLocation = program.shader->uniformLocation("inner_outline_width");
+    program.outerOutlineWidthLocation = program.shader->uniformLocation("outer_outline_width");
+    program.shadowTileLocation = program.shader->uniformLocation("shadow_tile");
+    program.shadowTileOriginsLocation = program.shader->uniformLocation("shadow_tile_origins");
+
+    if (variant & (Squircle | Shadow)) {
+        ShaderBinder binder(program.shader.get());
+        if (variant & Squircle) {
+            program.shader->setUniform("squircle_root", 1);
+        }
+        if ((variant & Shadow) && !(variant & BakeShadow)) {
+            program.shader->setUniform("shadow_tiles", 2);
+        }
+    }
+}
+
+void
+LSShader::setGeometry(const QRectF &frame, const QRectF &expanded)
+{
+    Program &p = *m_current;
+    setUniform(p.frameSizeLocation, p.frameSize, QVector2D(frame.width(), frame.height()));
+    setUniform(p.expandedSizeLocation, p.expandedSize, QVector2D(expanded.width(), expanded.height()));
+    setUniform(p.shadowSizeLocation, p.shadowSize, QVector3D(frame.x() - expanded.x(), frame.y() - expanded.y(), expanded.height() - frame.height() - frame.y() + expanded.y()));
+}
+
+void
+LSShader::setCorners(float radius, float shadowOffset)
+{
+    Program &p = *m_current;
+    setUniform(p.radiusLocation, p.radius, radius);
+    setUniform(p.shadowOffsetLocation, p.shadowOffset, shadowOffset);
+}
+
+void
+LSShader::setOutlines(const QColor &innerColor, float innerWidth,
+                      const QColor &outerColor, float outerWidth)
+{
+    Program &p = *m_current;
+    setUniform(p.innerOutlineColorLocation, p.innerOutlineColor, toVector(innerColor));
+    setUniform(p.innerOutlineWidthLocation, p.innerOutlineWidth, innerWidth);
+    setUniform(p.outerOutlineColorLocation, p.outerOutlineColor, toVector(outerColor));
+    setUniform(p.outerOutlineWidthLocation, p.outerOutlineWidth, outerWidth);
+}
+
+void
+LSShader::setShadowTiles(float tile, const QVector4D &origins)
+{
+    Program &p = *m_current;
+    setUniform(p.shadowTileLocation, p.shadowTile, tile);
+    setUniform(p.shadowTileOriginsLocation, p.shadowTileOrigins, origins);
+}
+
+void
+LSShader::setUniform(int location, float &cached, float value)
+{
+    if (cached == value) {
+        return;
+    }
+    cached = value;
+    m_current->shader->setUniform(location, value);
+}
+
+void
+LSShader::setUniform(int location, QVector2D &cached, const QVector2D &value)
+{
+    if (cached == value) {
+        return;
+    }
+    cached = value;
+    m_current->shader->setUniform(location, value);
+}
+
+void
+LSShader::setUniform(int location, QVector3D &cached, const QVector3D &value)
+{
+    if (cached == value) {
+        return;
+    }
+    cached = value;
+    m_current->shader->setUniform(location, value);
+}
+
+void
+LSShader::setUniform(int location, QVector4D &cached, const QVector4D &value)
+{
+    if (cached == value) {
+        return;
+    }
+    cached = value;
+    m_current->shader->setUniform(location, value);
+}
+
+} // namespace KWin
@@ -0,0 +1,135 @@
+#ifndef LSSHADER_H
+#define LSSHADER_H
+
+#include <kwinglutils.h>
+
+#include "lsprogrambuild.h"
+
+#include <QColor>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+
+namespace KWin {
+
+/*
+ * The rounded corners shader, compiled once per combination of the
+ * variant flags with the matching defines, so the fragment shader has no
+ * branches for features a window doesn't use. Variants are built the
+ * first time they are prepared or selected, in the background where the
+ * driver can, see LSProgramBuild, and can't be selected until poll()
+ * finished them. Each keeps its uniform locations and the last uploaded
+ * values, so only changed values reach the driver. The setters apply to
+ * the selected variant and expect it to be bound.
+ *
+ * On GLES 3 the shader comes from a source with colors at mediump,
+ * except on software rasterizers.
+ *
+ * Squircle variants are compiled for one ratio and raise to its power by
+ * multiplication. The final root comes from a small lookup texture bound
+ * to texture unit 1.
+ *
+ * Shadow variants take the shadow behind the corners from LSShadowTiles
+ * on texture unit 2, which BakeShadow renders from the window texture.
+ */
+class LSShader
+{
+public:
+    enum Variant {
+        Squircle = 1,
+        InnerOutline = 2,
+        OuterOutline = 4,
+        Shadow = 8,
+        BakeShadow = 16,
+        NVariants = 32
+    };
+
+    enum { SquircleRootSize = 256 };
+
+    LSShader();
+    ~LSShader();
+
+    bool isValid() const;
+
+    // Takes effect with the next prepare() or select()
+    void setSquircleRatio(int ratio);
+
+    // Starts building the variant if it isn't yet
+    void prepare(uint variant);
+    // Finishes the variants that are built, call once per frame
+    void poll();
+    bool isBuilding() const;
+
+    // Builds the variant like select(), but leaves the selection alone.
+    // True once select() returns it.
+    bool isReady(uint variant);
+    // Makes the variant the one the setters use and binds the textures it
+    // samples. Returns nullptr while it builds or if it doesn't compile.
+    GLShader *select(uint variant);
+
+    // Per window, in device pixels
+    void setGeometry(const QRectF &frame, const QRectF &expanded);
+
+    // Per output and config, in device pixels
+    void setCorners(float radius, float shadowOffset);
+    void setOutlines(const QColor &innerColor, float innerWidth,
+                     const QColor &outerColor, float outerWidth);
+
+    // Side of the corner squares of the shadow tiles and where they start
+    // in the window texture, see the shader, in device pixels
+    void setShadowTiles(float tile, const QVector4D &origins);
+
+private:
+    struct Program
+    {
+        bool started = false;
+        std::unique_ptr<LSProgramBuild> build;
+        std::unique_ptr<GLShader> shader;
+
+        int frameSizeLocation = -1;
+        int expandedSizeLocation = -1;
+        int shadowSizeLocation = -1;
+        int radiusLocation = -1;
+        int shadowOffsetLocation = -1;
+        int innerOutlineColorLocation = -1;
+        int outerOutlineColorLocation = -1;
+        int innerOutlineWidthLocation = -1;
+        int outerOutlineWidthLocation = -1;
+        int shadowTileLocation = -1;
+        int shadowTileOriginsLocation = -1;
+
+        // Start out of range so the first draw uploads everything
+        QVector2D frameSize = QVector2D(-1, -1);
+        QVector2D expandedSize = QVector2D(-1, -1);
+        QVector3D shadowSize = QVector3D(-1, -1, -1);
+        float radius = -1;
+        float shadowOffset = -1;
+        QVector4D innerOutlineColor = QVector4D(-1, -1, -1, -1);
+        QVector4D outerOutlineColor = QVector4D(-1, -1, -1, -1);
+        float innerOutlineWidth = -1;
+        float outerOutlineWidth = -1;
+        float shadowTile = -1;
+        QVector4D shadowTileOrigins = QVector4D(-1, -1, -1, -1);
+    };
+
+    void compile(uint variant);
+    void finish(uint variant);
+    void updateSquircleRoot();
+
+    void setUniform(int location, float &cached, float value);
+    void setUniform(int location, QVector2D &cached, const QVector2D &value);
+    void setUniform(int location, QVector3D &cached, const QVector3D &value);
+    void setUniform(int location, QVector4D &cached, const QVector4D &value);
+
+    QByteArray m_source;
+    Program m_programs[NVariants];
+    Program *m_current = nullptr;
+
+    int m_squircleRatio = 0;
+    bool m_squircleRatioChanged = false;
+    GLuint m_squircleRoot = 0;
+};
+
+} // namespace KWin
+
+#endif //LSSHADER_H
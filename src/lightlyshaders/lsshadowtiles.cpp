@@ -0,0 +1,53 @@
+#include "lsshadowtiles.h"
+
+namespace KWin {
+
+bool
+LSShadowTiles::isBaked(int tile) const
+{
+    return m_baked && m_tile == tile;
+}
+
+void
+LSShadowTiles::invalidate()
+{
+    m_baked = false;
+}
+
+bool
+LSShadowTiles::beginBake(int tile)
+{
+    m_baked = false;
+
+    if (!m_texture || m_tile != tile) {
+        m_target.reset();
+        m_texture = std::make_unique<GLTexture>(GL_RGBA8, QSize(2 * tile, 2 * tile));
+        m_texture->setFilter(GL_LINEAR);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_target = std::make_unique<GLFramebuffer>(m_texture.get());
+        m_tile = tile;
+    }
+    if (!m_target->valid()) {
+        return false;
+    }
+
+    GLFramebuffer::pushFramebuffer(m_target.get());
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return true;
+}
+
+void
+LSShadowTiles::endBake()
+{
+    GLFramebuffer::popFramebuffer();
+    m_baked = true;
+}
+
+GLTexture *
+LSShadowTiles::texture() const
+{
+    return m_texture.get();
+}
+
+} // namespace KWin
@@ -0,0 +1,38 @@
+#ifndef LSSHADOWTILES_H
+#define LSSHADOWTILES_H
+
+#include <kwinglutils.h>
+
+namespace KWin {
+
+/*
+ * The decoration shadow behind the four corners of one window, baked into
+ * one texture so the corner shader reads it with one fetch instead of
+ * rebuilding it from the shadow next to the frame edges every frame. Each
+ * corner takes a square of the texture, the left corners the left half
+ * and the bottom corners the bottom half, y up. It stays baked until the
+ * window geometry or its decoration change.
+ */
+class LSShadowTiles
+{
+public:
+    // tile is the side of one corner square, in device pixels
+    bool isBaked(int tile) const;
+    void invalidate();
+
+    // Makes the texture the render target, cleared, until endBake()
+    bool beginBake(int tile);
+    void endBake();
+
+    GLTexture *texture() const;
+
+private:
+    std::unique_ptr<GLTexture> m_texture;
+    std::unique_ptr<GLFramebuffer> m_target;
+    int m_tile = 0;
+    bool m_baked = false;
+};
+
+} // namespace KWin
+
+#endif //LSSHADOWTILES_H
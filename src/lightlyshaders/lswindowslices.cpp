@@ -0,0 +1,70 @@
+#include "lswindowslices.h"
+
+#include <algorithm>
+
+namespace KWin {
+
+// Where the insets fall on one axis, clamped to the expanded geometry
+static QVector<qreal>
+sliceLines(qreal start, qreal end, qreal size, const LSWindowSlices::Insets &insets)
+{
+    QVector<qreal> lines = {
+        start,
+        -insets.outside,
+        insets.inside,
+        insets.radius,
+        size - insets.radius,
+        size - insets.inside,
+        size + insets.outside,
+        end
+    };
+    for (qreal &line : lines) {
+        line = qBound(start, line, end);
+    }
+    std::sort(lines.begin(), lines.end());
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+    return lines;
+}
+
+/*
+ * The lines cut the expanded geometry into a grid whose cells each lie
+ * within one kind of area, so the center of a cell tells which shader it
+ * needs. Neighbouring cells of a row that need the same are merged.
+ */
+void
+LSWindowSlices::split(const QSizeF &frame, const QRectF &expanded, const Insets &insets,
+                      QVector<QRectF> *shaded, QVector<QRectF> *plain)
+{
+    shaded->clear();
+    plain->clear();
+
+    const QVector<qreal> xs = sliceLines(expanded.left(), expanded.right(), frame.width(), insets);
+    const QVector<qreal> ys = sliceLines(expanded.top(), expanded.bottom(), frame.height(), insets);
+
+    for (int row = 0; row + 1 < ys.size(); ++row) {
+        const qreal cy = (ys[row] + ys[row + 1]) / 2;
+        const qreal ey = qMin(cy, frame.height() - cy);
+
+        QVector<QRectF> *current = nullptr;
+        for (int column = 0; column + 1 < xs.size(); ++column) {
+            const qreal cx = (xs[column] + xs[column + 1]) / 2;
+            const qreal ex = qMin(cx, frame.width() - cx);
+
+            // Distances inside the nearest frame edges, as in the shader
+            const bool inReach = ex > -insets.outside && ey > -insets.outside;
+            const bool corner = ex < insets.radius && ey < insets.radius;
+            const bool band = ex < insets.inside || ey < insets.inside;
+            QVector<QRectF> *slices = (inReach && (corner || band)) ? shaded : plain;
+
+            const QRectF cell(QPointF(xs[column], ys[row]), QPointF(xs[column + 1], ys[row + 1]));
+            if (slices == current) {
+                slices->last() = slices->last().united(cell);
+            } else {
+                slices->append(cell);
+                current = slices;
+            }
+        }
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,33 @@
+#ifndef LSWINDOWSLICES_H
+#define LSWINDOWSLICES_H
+
+#include <QRectF>
+#include <QVector>
+
+namespace KWin {
+
+/*
+ * Splits the expanded geometry of a window into the rects the corner
+ * shader can change, the corner tiles and the bands along the frame edges,
+ * and the rest, which the plain texture shader draws the same. Everything
+ * is in logical pixels relative to the top left of the frame.
+ */
+class LSWindowSlices
+{
+public:
+    struct Insets
+    {
+        // How far the corner tiles reach into the frame
+        qreal radius = 0;
+        // How far the edge bands reach into and out of the frame
+        qreal inside = 0;
+        qreal outside = 0;
+    };
+
+    static void split(const QSizeF &frame, const QRectF &expanded, const Insets &insets,
+                      QVector<QRectF> *shaded, QVector<QRectF> *plain);
+};
+
+} // namespace KWin
+
+#endif //LSWINDOWSLICES_H
@@ -7,14 +7,36 @@ uniform vec2 frame_size;
 uniform vec3 shadow_size;
 uniform float radius;
 uniform float shadow_sample_offset;
-uniform bool draw_inner_outline;
-uniform bool draw_outer_outline;
 uniform float inner_outline_width;
 uniform float outer_outline_width;
 uniform vec4 inner_outline_color;
 uniform vec4 outer_outline_color;
-uniform int squircle_ratio;
-uniform bool is_squircle;
+
+// The shadow behind the corners, baked by the LS_BAKE_SHADOW variant into
+// squares of shadow_tile pixels, see LSShadowTiles. The squares start at
+// whole pixels of the window texture, left and right in x and bottom and
+// top in y of shadow_tile_origins.
+uniform sampler2D shadow_tiles;
+uniform float shadow_tile;
+uniform vec4 shadow_tile_origins;
+
+// Permutations, LSShader compiles one program per combination of defines.
+// Squircle variants also get the ratio as LS_SQUIRCLE_RATIO.
+#ifdef LS_INNER_OUTLINE
+const bool draw_inner_outline = true;
+#else
+const bool draw_inner_outline = false;
+#endif
+#ifdef LS_OUTER_OUTLINE
+const bool draw_outer_outline = true;
+#else
+const bool draw_outer_outline = false;
+#endif
+#ifdef LS_SHADOW
+const bool has_shadow = true;
+#else
+const bool has_shadow = false;
+#endif
 
 uniform mat4 modelViewProjectionMatrix;
 
@@ -23,419 +45,164 @@ uniform float saturation;
 
 varying vec2 texcoord0;
 
-//Used code from https://github.com/yilozt/rounded-window-corners project
-float squircleBounds(vec2 p, vec2 center, float clip_radius)
-{
-    vec2 delta = abs(p - center);
-    float f_squircle_ratio = float(squircle_ratio);
-
-    float pow_dx = pow(delta.x, f_squircle_ratio);
-    float pow_dy = pow(delta.y, f_squircle_ratio);
+#ifdef LS_SQUIRCLE
+// (1 + x)^(1/ratio) and its slope at 256 points of [0, 1], each with
+// 16 bits in two channels, see LSShader
+uniform sampler2D squircle_root;
 
-    float dist = pow(pow_dx + pow_dy, 1.0 / f_squircle_ratio);
-
-    return clamp(clip_radius - dist + 0.5, 0.0, 1.0);
+// t^ratio by multiplication
+float squirclePower(float t)
+{
+    float result = 1.0;
+    float t2 = t * t;
+    float t4 = t2 * t2;
+#if LS_SQUIRCLE_RATIO % 2 == 1
+    result *= t;
+#endif
+#if (LS_SQUIRCLE_RATIO / 2) % 2 == 1
+    result *= t2;
+#endif
+#if (LS_SQUIRCLE_RATIO / 4) % 2 == 1
+    result *= t4;
+#endif
+#if LS_SQUIRCLE_RATIO >= 8
+    result *= t4 * t4;
+#endif
+    return result;
 }
+#endif
 
-//Used code from https://github.com/yilozt/rounded-window-corners project
-float circleBounds(vec2 p, vec2 center, float clip_radius)
+// Distance of p from the corner center, with p relative to that center
+// and pointing away from the window
+float cornerDistance(vec2 p)
 {
-    vec2 delta = p - vec2(center.x, center.y);
-    float dist_squared = dot(delta, delta);
-
-    float outer_radius = clip_radius + 0.5;
-    if(dist_squared >= (outer_radius * outer_radius))
-        return 0.0;
-
-    float inner_radius = clip_radius - 0.5;
-    if(dist_squared <= (inner_radius * inner_radius))
-        return 1.0;
-
-    return outer_radius - sqrt(dist_squared);
+#ifdef LS_SQUIRCLE
+    // The superellipse norm written as max * (1 + (min/max)^ratio)^(1/ratio),
+    // which only needs the root on [1, 2]
+    float large = max(p.x, p.y);
+    float x = squirclePower(min(p.x, p.y) / large);
+
+    // Continued from the nearest point along its slope
+    float i = floor(x * 255.0 + 0.5);
+    vec4 root = texture2D(squircle_root, vec2((i + 0.5) / 256.0, 0.5));
+    float value = 1.0 + (root.r + root.g / 255.0) * 0.41421356;
+    float slope = (root.b + root.a / 255.0) * 0.5;
+    return large * (value + slope * (x - i / 255.0));
+#else
+    return length(p);
+#endif
 }
 
-vec4 shapeWindow(vec4 tex, vec2 p, vec2 center, float clip_radius)
+// How much of the pixel at distance dist lies inside clip_radius
+float coverage(float dist, float clip_radius)
 {
-    float alpha;
-    if(is_squircle) {
-        alpha = squircleBounds(p, center, clip_radius);
-    } else {
-        alpha = circleBounds(p, center, clip_radius);
-    }
-    return vec4(tex.rgb*alpha, min(alpha, tex.a));
+    return clamp(clip_radius - dist + 0.5, 0.0, 1.0);
 }
 
-vec4 shapeShadowWindow(vec2 start, vec4 tex, vec2 p, vec2 center, float clip_radius)
+vec4 drawOutline(vec4 color, vec4 outline_color, float alpha)
 {
-    vec2 ShadowHorCoord = vec2(texcoord0.x, start.y);
-    vec2 ShadowVerCoord = vec2(start.x, texcoord0.y);
-
-    vec4 texShadowHorCur = texture2D(sampler, ShadowHorCoord);
-    vec4 texShadowVerCur = texture2D(sampler, ShadowVerCoord);
-    vec4 texShadow0 = texture2D(sampler, start);
-
-    vec4 texShadow = texShadowHorCur + (texShadowVerCur - texShadow0);
-
-    float alpha;
-    if(is_squircle) {
-        alpha = squircleBounds(p, center, clip_radius);
-    } else {
-        alpha = circleBounds(p, center, clip_radius);
-    }
-
-    if(alpha == 0.0) {
-        return texShadow;
-    } else if(alpha < 1.0) {
-        return mix(vec4(tex.rgb*alpha, min(alpha, tex.a)), texShadow, 1.0-alpha);
-    } else {
-        return tex;
-    }
+    return mix(color, vec4(outline_color.rgb, 1.0), alpha * outline_color.a);
 }
 
-vec4 cornerOutline(vec4 outColor, bool inner, vec2 coord0, float radius, vec2 center, float outline_width, bool invert)
+// Outlines across a straight frame edge, edge is the distance inside of
+// the frame
+vec4 shapeEdge(vec4 color, float edge)
 {
-    vec4 outline_color;
-    float radius_delta_inner;
-    float radius_delta_outer;
-
-    if(inner) {
-        outline_color = inner_outline_color;
-        radius_delta_outer = 0.0;
-        radius_delta_inner = -outline_width;
-
-        if(invert) {
-            radius_delta_inner = 0.0;
-            radius_delta_outer = outline_width;
+    if(has_shadow) {
+        if(draw_inner_outline && edge >= 0.0 && edge <= inner_outline_width) {
+            color = drawOutline(color, inner_outline_color, 1.0);
         }
-    } else {
-        outline_color = outer_outline_color;
-        radius_delta_inner = 0.0;
-        radius_delta_outer = outline_width;
-
-        if(invert) {
-            radius_delta_outer = 0.0;
-            radius_delta_inner = -outline_width;
+        if(draw_outer_outline && edge >= -outer_outline_width && edge <= 0.0) {
+            color = drawOutline(color, outer_outline_color, 1.0);
         }
-    }
-
-    float outline_alpha;
-    float outline_alpha_inner;
-    float outline_alpha_outer;
-
-    if(is_squircle) {
-        outline_alpha_inner = squircleBounds(coord0, vec2(center.x, center.y), radius + radius_delta_inner);
-        outline_alpha_outer = squircleBounds(coord0, vec2(center.x, center.y), radius + radius_delta_outer);
     } else {
-        outline_alpha_inner = circleBounds(coord0, vec2(center.x, center.y), radius + radius_delta_inner);
-        outline_alpha_outer = circleBounds(coord0, vec2(center.x, center.y), radius + radius_delta_outer);
+        if(draw_inner_outline && edge >= outer_outline_width && edge <= outer_outline_width + inner_outline_width) {
+            color = drawOutline(color, inner_outline_color, 1.0);
+        }
+        if(draw_outer_outline && edge >= 0.0 && edge <= outer_outline_width) {
+            color = drawOutline(color, outer_outline_color, 1.0);
+        }
     }
-    outline_alpha = 1.0 - clamp(abs(outline_alpha_outer - outline_alpha_inner), 0.0, 1.0);
-    outColor = mix(outColor, vec4(outline_color.rgb,1.0), (1.0-outline_alpha) * outline_color.a);
-    return outColor;
+    return color;
 }
 
 void main()
 {
-    vec4 tex = texture2D(sampler, texcoord0);
-    vec2 coord0;
-    vec4 outColor;
-    float start_x;
-    float start_y;
-
-    float f_shadow_sample_offset = float(shadow_sample_offset);
-    float f_radius = float(radius);
-
-    //Window without shadow
-    if(expanded_size == frame_size) {
-        coord0 = vec2(texcoord0.x*frame_size.x, texcoord0.y*frame_size.y);
-        //Left side
-        if (coord0.x < f_radius) {
-            //Bottom left corner
-            if (coord0.y < f_radius) {
-                outColor = shapeWindow(tex, coord0, vec2(f_radius, f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius-outer_outline_width, vec2(f_radius, f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(f_radius, f_radius), outer_outline_width, true);
-                }
-            //Top left corner
-            } else if (coord0.y > frame_size.y - f_radius) {
-                outColor = shapeWindow(tex, coord0, vec2(f_radius, frame_size.y - f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius-outer_outline_width, vec2(f_radius, frame_size.y - f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(f_radius, frame_size.y - f_radius), outer_outline_width, true);
-                }
-            //Center
-            } else {
-                outColor = tex;
-
-                //Outline
-                if(coord0.y > f_radius && coord0.y < frame_size.y - f_radius) {
-                    //Inner outline
-                    if(draw_inner_outline) {
-                        if(coord0.x >= outer_outline_width && coord0.x <= outer_outline_width+inner_outline_width) {
-                            outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                        }
-                    }
-                    //Outer outline
-                    if(draw_outer_outline) {
-                        if(
-                            (coord0.x >= 0.0 && coord0.x <= outer_outline_width)
-                        ) {
-                            outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                        }
-                    }
-                }
-            }
-        //Right side
-        } else if (coord0.x > frame_size.x - f_radius) {
-            //Bottom right corner
-            if (coord0.y < f_radius) {
-                outColor = shapeWindow(tex, coord0, vec2(frame_size.x - f_radius, f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius-outer_outline_width, vec2(frame_size.x - f_radius, f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(frame_size.x - f_radius, f_radius), outer_outline_width, true);
-                }
-            //Top right corner
-            } else if (coord0.y > frame_size.y - f_radius) {
-                outColor = shapeWindow(tex, coord0, vec2(frame_size.x - f_radius, frame_size.y - f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius-outer_outline_width, vec2(frame_size.x - f_radius, frame_size.y - f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(frame_size.x - f_radius, frame_size.y - f_radius), outer_outline_width, true);
-                }
-            //Center
-            } else {
-                outColor = tex;
-
-                //Outline
-                if(coord0.y > f_radius && coord0.y < frame_size.y - f_radius) {
-                    //Inner outline
-                    if(draw_inner_outline) {
-                        if(coord0.x >= frame_size.x - inner_outline_width - outer_outline_width && coord0.x <= frame_size.x - outer_outline_width) {
-                            outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                        }
-                    }
-                    //Outer outline
-                    if(draw_outer_outline) {
-                        if(
-                            (coord0.x >= frame_size.x - outer_outline_width && coord0.x <= frame_size.x )
-                        ) {
-                            outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                        }
-                    }
-                }
-            }
-        //Center
-        } else {
-            outColor = tex;
-
-            //Outline
-            if(coord0.x > f_radius && coord0.x < frame_size.x - f_radius) {
-                //Inner outline
-                if(draw_inner_outline) {
-                    if(
-                        (coord0.y >= frame_size.y - inner_outline_width - outer_outline_width && coord0.y <= frame_size.y - outer_outline_width )
-                        || (coord0.y >= outer_outline_width && coord0.y <= outer_outline_width + inner_outline_width)
-                    ) {
-                        outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                    }
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    if(
-                        (coord0.y >= frame_size.y - outer_outline_width  && coord0.y <= frame_size.y)
-                        || (coord0.y >= 0.0 && coord0.y <= outer_outline_width)
-                    ) {
-                        outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                    }
-                }
-            }
+    // The frame as a rounded rectangle, p is relative to its center and
+    // edge the distance inside of its nearest edges, negative outside
+    vec2 coord0 = texcoord0 * expanded_size;
+    vec2 frame_origin = has_shadow ? shadow_size.xz : vec2(0.0);
+    vec2 half_size = frame_size * 0.5;
+    vec2 p = coord0 - frame_origin - half_size;
+    vec2 edge = half_size - abs(p);
+    vec2 corner = radius - edge;
+
+    // Where the shadow around the frame is sampled
+    float shadow_reach = max(shadow_sample_offset, outer_outline_width);
+    vec2 shadow_start = (frame_origin + half_size + sign(p) * (half_size + shadow_sample_offset)) / expanded_size;
+
+#ifdef LS_BAKE_SHADOW
+    // The shadow behind a corner continued from both edges next to it
+    gl_FragColor = texture2D(sampler, vec2(texcoord0.x, shadow_start.y))
+               + texture2D(sampler, vec2(shadow_start.x, texcoord0.y))
+               - texture2D(sampler, shadow_start);
+    return;
+#endif
+
+    // The shadow next to the straight frame edges is moved out by the
+    // sample offset, those pixels read it instead of the window
+    vec2 sample_coord = texcoord0;
+    if(has_shadow) {
+        if(corner.x > 0.0 && corner.y < 0.0 && edge.x > -shadow_sample_offset && edge.x <= 0.0) {
+            sample_coord.x = shadow_start.x;
+        } else if(corner.x < 0.0 && edge.y > -shadow_sample_offset && edge.y <= 0.0) {
+            sample_coord.y = shadow_start.y;
         }
-    //Window with shadow
-    } else if(expanded_size != frame_size) {
-        coord0 = vec2(texcoord0.x*expanded_size.x, texcoord0.y*expanded_size.y);
-        //Left side
-        if (coord0.x > shadow_size.x - max(f_shadow_sample_offset, outer_outline_width) && coord0.x < f_radius + shadow_size.x) {
-            //Top left corner
-            if (coord0.y > frame_size.y + shadow_size.z - f_radius && coord0.y < frame_size.y + shadow_size.z + max(f_shadow_sample_offset, outer_outline_width)) {
-                start_x = (shadow_size.x - f_shadow_sample_offset)/expanded_size.x;
-                start_y = (shadow_size.z + frame_size.y + f_shadow_sample_offset)/expanded_size.y;
-                
-                outColor = shapeShadowWindow(vec2(start_x, start_y), tex, coord0, vec2(f_radius + shadow_size.x, frame_size.y + shadow_size.z - f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius, vec2(f_radius + shadow_size.x, frame_size.y + shadow_size.z - f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(f_radius + shadow_size.x, frame_size.y + shadow_size.z - f_radius), outer_outline_width, false);
-                }
-            //Bottom left corner
-            } else if (coord0.y > shadow_size.z - max(f_shadow_sample_offset, outer_outline_width) && coord0.y < f_radius + shadow_size.z) {
-                start_x = (shadow_size.x - f_shadow_sample_offset)/expanded_size.x;
-                start_y = (shadow_size.z - f_shadow_sample_offset)/expanded_size.y;
-
-                outColor = shapeShadowWindow(vec2(start_x, start_y), tex, coord0, vec2(f_radius + shadow_size.x, shadow_size.z + f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius, vec2(f_radius + shadow_size.x, shadow_size.z + f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(f_radius + shadow_size.x, shadow_size.z + f_radius), outer_outline_width, false);
+    }
+    vec4 tex = texture2D(sampler, sample_coord);
+    vec4 outColor = tex;
+
+    //Corners
+    if(corner.x > 0.0 && corner.y > 0.0) {
+        if(!has_shadow || (edge.x > -shadow_reach && edge.y > -shadow_reach)) {
+            float dist = cornerDistance(corner);
+            float alpha = coverage(dist, radius);
+            vec4 shaped = vec4(tex.rgb*alpha, min(alpha, tex.a));
+
+            if(has_shadow) {
+                vec2 quadrant = step(0.0, p);
+                vec2 tile_coord = coord0 - mix(shadow_tile_origins.xz, shadow_tile_origins.yw, quadrant) + quadrant * shadow_tile;
+                vec4 texShadow = texture2D(shadow_tiles, tile_coord / (2.0 * shadow_tile));
+                if(alpha == 0.0) {
+                    outColor = texShadow;
+                } else if(alpha < 1.0) {
+                    outColor = mix(shaped, texShadow, 1.0-alpha);
                 }
-            //Center
             } else {
-                outColor = tex;
-
-                //Outline and shadow
-                if(coord0.y > f_radius + shadow_size.z && coord0.y < shadow_size.z + frame_size.y - f_radius) {
-                    //Left shadow padding
-                    if(coord0.x > shadow_size.x - f_shadow_sample_offset && coord0.x <= shadow_size.x) {
-                        start_x = (shadow_size.x - f_shadow_sample_offset)/expanded_size.x;                        
-                        vec4 texShadowEdge = texture2D(sampler, vec2(start_x, texcoord0.y));
-                        outColor = texShadowEdge;
-                    }
-
-                    //Inner outline
-                    if(draw_inner_outline) {
-                        if(coord0.x >= shadow_size.x && coord0.x <= shadow_size.x+inner_outline_width) {
-                            outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                        }
-                    }
-                    //Outer outline
-                    if(draw_outer_outline) {
-                        if(
-                            (coord0.x >= shadow_size.x - outer_outline_width && coord0.x <= shadow_size.x)
-                        ) {
-                            outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                        }
-                    }
-                }
+                outColor = shaped;
             }
-        //Right side
-        } else if (coord0.x > shadow_size.x + frame_size.x - f_radius && coord0.x < shadow_size.x + frame_size.x + max(f_shadow_sample_offset, outer_outline_width)) {
-            //Top right corner
-            if (coord0.y > frame_size.y + shadow_size.z - f_radius && coord0.y < frame_size.y + shadow_size.z + max(f_shadow_sample_offset, outer_outline_width)) {
-                start_x = (shadow_size.x + frame_size.x + f_shadow_sample_offset)/expanded_size.x;
-                start_y = (shadow_size.z + frame_size.y + f_shadow_sample_offset)/expanded_size.y;
-
-                outColor = shapeShadowWindow(vec2(start_x, start_y), tex, coord0, vec2(shadow_size.x + frame_size.x - f_radius, frame_size.y + shadow_size.z - f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius, vec2(shadow_size.x + frame_size.x - f_radius, frame_size.y + shadow_size.z - f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(shadow_size.x + frame_size.x - f_radius, frame_size.y + shadow_size.z - f_radius), outer_outline_width, false);
-                }
-            //Bottom right corner
-            } else if (coord0.y > shadow_size.z - max(f_shadow_sample_offset, outer_outline_width) && coord0.y < f_radius + shadow_size.z) {
-                start_x = (shadow_size.x + frame_size.x + f_shadow_sample_offset)/expanded_size.x;
-                start_y = (shadow_size.z - f_shadow_sample_offset)/expanded_size.y;
-
-                outColor = shapeShadowWindow(vec2(start_x, start_y), tex, coord0, vec2(shadow_size.x + frame_size.x - f_radius, shadow_size.z + f_radius), f_radius);
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    outColor = cornerOutline(outColor, true, coord0, f_radius, vec2(shadow_size.x + frame_size.x - f_radius, shadow_size.z + f_radius), inner_outline_width, false);
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    outColor = cornerOutline(outColor, false, coord0, f_radius, vec2(shadow_size.x + frame_size.x - f_radius, shadow_size.z + f_radius), outer_outline_width, false);
-                }
-            //Center
-            } else {
-                outColor = tex;
-
-                //Outline and shadow
-                if(coord0.y > f_radius + shadow_size.z && coord0.y < shadow_size.z + frame_size.y - f_radius) {
-                    //Right shadow padding
-                    if(coord0.x >= shadow_size.x + frame_size.x && coord0.x < shadow_size.x + frame_size.x + f_shadow_sample_offset) {
-                        start_x = (shadow_size.x + frame_size.x + f_shadow_sample_offset)/expanded_size.x;
-                        vec4 texShadowEdge = texture2D(sampler, vec2(start_x, texcoord0.y));
-                        outColor = texShadowEdge;
-                    }
 
-                    //Inner outline
-                    if(draw_inner_outline) {
-                        if(coord0.x >= frame_size.x + shadow_size.x - inner_outline_width && coord0.x <= frame_size.x + shadow_size.x) {
-                            outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                        }
-                    }
-                    //Outer outline
-                    if(draw_outer_outline) {
-                        if(
-                            (coord0.x >= frame_size.x + shadow_size.x && coord0.x <= frame_size.x + shadow_size.x + outer_outline_width)
-                        ) {
-                            outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                        }
-                    }
-                }
+            // Without a shadow the outer outline is drawn inside the frame
+            float outer_edge = has_shadow ? radius + outer_outline_width : radius;
+            float inner_edge = outer_edge - outer_outline_width;
+            float inner_coverage = coverage(dist, inner_edge);
+            if(draw_inner_outline) {
+                outColor = drawOutline(outColor, inner_outline_color, inner_coverage - coverage(dist, inner_edge - inner_outline_width));
             }
-        //Center
-        } else {
-            outColor = tex;
-
-            //Outline and shadow
-            if(coord0.x > f_radius + shadow_size.x && coord0.x < shadow_size.x + frame_size.x - f_radius) {
-                //Top shadow padding
-                if(coord0.y >= frame_size.y + shadow_size.z && coord0.y < frame_size.y + shadow_size.z + f_shadow_sample_offset) {
-                    start_y = (shadow_size.z + frame_size.y + f_shadow_sample_offset)/expanded_size.y;
-                    vec4 texShadowEdge = texture2D(sampler, vec2(texcoord0.x, start_y));
-                    outColor = texShadowEdge;
-                //Bottom shadow padding
-                } else if(coord0.y <= shadow_size.z && coord0.y > shadow_size.z - f_shadow_sample_offset) {
-                    start_y = (shadow_size.z - f_shadow_sample_offset)/expanded_size.y;
-                    vec4 texShadowEdge = texture2D(sampler, vec2(texcoord0.x, start_y));
-                    outColor = texShadowEdge;
-                }
-
-                //Inner outline
-                if(draw_inner_outline) {
-                    if(
-                        (coord0.y >= frame_size.y + shadow_size.z - inner_outline_width && coord0.y <= frame_size.y + shadow_size.z)
-                        || (coord0.y >= shadow_size.z && coord0.y <= shadow_size.z + inner_outline_width)
-                    ) {
-                        outColor = mix(outColor, vec4(inner_outline_color.rgb,1.0), inner_outline_color.a);
-                    }
-                }
-                //Outer outline
-                if(draw_outer_outline) {
-                    if(
-                        (coord0.y >= frame_size.y + shadow_size.z && coord0.y <= frame_size.y + shadow_size.z + outer_outline_width)
-                        || (coord0.y >= shadow_size.z - outer_outline_width && coord0.y <= shadow_size.z)
-                    ) {
-                        outColor = mix(outColor, vec4(outer_outline_color.rgb,1.0), outer_outline_color.a);
-                    }
-                }
+            if(draw_outer_outline) {
+                outColor = drawOutline(outColor, outer_outline_color, coverage(dist, outer_edge) - inner_coverage);
             }
         }
+    //Left and right edge
+    } else if(corner.x > 0.0) {
+        if(corner.y < 0.0 && (!has_shadow || edge.x > -shadow_reach)) {
+            outColor = shapeEdge(outColor, edge.x);
+        }
+    //Top and bottom edge
+    } else if(corner.x < 0.0) {
+        outColor = shapeEdge(outColor, edge.y);
     }
 
-
     //Support opacity
     if (saturation != 1.0) {
         vec3 desaturated = outColor.rgb * vec3( 0.30, 0.59, 0.11 );
@@ -446,5 +213,4 @@ void main()
 
     //Output result
     gl_FragColor = outColor;
-    //gl_FragColor = vec4(tex.r, tex.g, 1.0, tex.a);
 }
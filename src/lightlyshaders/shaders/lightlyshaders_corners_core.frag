@@ -0,0 +1,114 @@
+#version 140
+
+// Composites one corner tile of a window that was drawn straight to the
+// render target. Both textures hold the tile in device pixels, anchored
+// at the bottom left: the background before the window was drawn and the
+// result after it was drawn.
+uniform sampler2D background_sampler;
+uniform sampler2D window_sampler;
+
+uniform vec2 texture_size;
+uniform vec2 center;
+uniform vec2 shadow_start;
+uniform bool has_shadow;
+uniform float radius;
+uniform bool draw_inner_outline;
+uniform bool draw_outer_outline;
+uniform float inner_outline_width;
+uniform float outer_outline_width;
+uniform vec4 inner_outline_color;
+uniform vec4 outer_outline_color;
+uniform int squircle_ratio;
+uniform bool is_squircle;
+
+uniform mat4 modelViewProjectionMatrix;
+
+in vec2 texcoord0;
+out vec4 fragColor;
+
+//Used code from https://github.com/yilozt/rounded-window-corners project
+float squircleBounds(vec2 p, vec2 center, float clip_radius)
+{
+    vec2 delta = abs(p - center);
+    float f_squircle_ratio = float(squircle_ratio);
+
+    float pow_dx = pow(delta.x, f_squircle_ratio);
+    float pow_dy = pow(delta.y, f_squircle_ratio);
+
+    float dist = pow(pow_dx + pow_dy, 1.0 / f_squircle_ratio);
+
+    return clamp(clip_radius - dist + 0.5, 0.0, 1.0);
+}
+
+//Used code from https://github.com/yilozt/rounded-window-corners project
+float circleBounds(vec2 p, vec2 center, float clip_radius)
+{
+    vec2 delta = p - vec2(center.x, center.y);
+    float dist_squared = dot(delta, delta);
+
+    float outer_radius = clip_radius + 0.5;
+    if(dist_squared >= (outer_radius * outer_radius))
+        return 0.0;
+
+    float inner_radius = clip_radius - 0.5;
+    if(dist_squared <= (inner_radius * inner_radius))
+        return 1.0;
+
+    return outer_radius - sqrt(dist_squared);
+}
+
+float cornerBounds(vec2 p, float clip_radius)
+{
+    if(is_squircle) {
+        return squircleBounds(p, center, clip_radius);
+    }
+    return circleBounds(p, center, clip_radius);
+}
+
+vec4 cornerOutline(vec4 outColor, vec2 p, float clip_radius, float inner_delta, float outer_delta, vec4 outline_color)
+{
+    float outline_alpha_inner = cornerBounds(p, clip_radius + inner_delta);
+    float outline_alpha_outer = cornerBounds(p, clip_radius + outer_delta);
+    float outline_alpha = 1.0 - clamp(abs(outline_alpha_outer - outline_alpha_inner), 0.0, 1.0);
+    return mix(outColor, vec4(outline_color.rgb, 1.0), (1.0 - outline_alpha) * outline_color.a);
+}
+
+void main()
+{
+    vec2 p = texcoord0 * texture_size;
+    vec4 background = texture(background_sampler, texcoord0);
+    vec4 win = texture(window_sampler, texcoord0);
+    float alpha = cornerBounds(p, radius);
+    vec4 outColor;
+
+    if(has_shadow) {
+        //Rebuild what the shadow adds to the background under the corner
+        //from the rows and columns of shadow just outside of the frame
+        vec2 start = shadow_start / texture_size;
+        vec2 hor = vec2(texcoord0.x, start.y);
+        vec2 ver = vec2(start.x, texcoord0.y);
+        vec4 shadowHor = texture(window_sampler, hor) - texture(background_sampler, hor);
+        vec4 shadowVer = texture(window_sampler, ver) - texture(background_sampler, ver);
+        vec4 shadow0 = texture(window_sampler, start) - texture(background_sampler, start);
+        vec4 shadow = clamp(background + shadowHor + (shadowVer - shadow0), 0.0, 1.0);
+        outColor = mix(shadow, win, alpha);
+
+        if(draw_inner_outline) {
+            outColor = cornerOutline(outColor, p, radius, -inner_outline_width, 0.0, inner_outline_color);
+        }
+        if(draw_outer_outline) {
+            outColor = cornerOutline(outColor, p, radius, 0.0, outer_outline_width, outer_outline_color);
+        }
+    } else {
+        outColor = mix(background, win, alpha);
+
+        if(draw_inner_outline) {
+            outColor = cornerOutline(outColor, p, radius - outer_outline_width, -inner_outline_width, 0.0, inner_outline_color);
+        }
+        if(draw_outer_outline) {
+            outColor = cornerOutline(outColor, p, radius, -outer_outline_width, 0.0, outer_outline_color);
+        }
+    }
+
+    fragColor = outColor;
+}
@@ -0,0 +1,231 @@
+#version 300 es
+
+// Colors and coverage at mediump, which low power GPUs run at half the
+// cost. Everything in window pixels stays highp, mediump can't hold them
+// to a fraction of a pixel on large windows, and so does the squircle
+// distance, which would be off by up to 3/255 in coverage at mediump.
+// Software rasterizers emulate mediump and get slower, LSShader compiles
+// this with LS_FULL_PRECISION for them.
+#ifdef LS_FULL_PRECISION
+precision highp float;
+precision highp sampler2D;
+#else
+precision mediump float;
+precision mediump sampler2D;
+#endif
+
+uniform sampler2D sampler;
+
+uniform highp vec2 expanded_size;
+uniform highp vec2 frame_size;
+uniform highp vec3 shadow_size;
+uniform highp float radius;
+uniform highp float shadow_sample_offset;
+uniform highp float inner_outline_width;
+uniform highp float outer_outline_width;
+uniform vec4 inner_outline_color;
+uniform vec4 outer_outline_color;
+
+// The shadow behind the corners, baked by the LS_BAKE_SHADOW variant into
+// squares of shadow_tile pixels, see LSShadowTiles. The squares start at
+// whole pixels of the window texture, left and right in x and bottom and
+// top in y of shadow_tile_origins.
+uniform sampler2D shadow_tiles;
+uniform highp float shadow_tile;
+uniform highp vec4 shadow_tile_origins;
+
+// Permutations, LSShader compiles one program per combination of defines.
+// Squircle variants also get the ratio as LS_SQUIRCLE_RATIO.
+#ifdef LS_INNER_OUTLINE
+const bool draw_inner_outline = true;
+#else
+const bool draw_inner_outline = false;
+#endif
+#ifdef LS_OUTER_OUTLINE
+const bool draw_outer_outline = true;
+#else
+const bool draw_outer_outline = false;
+#endif
+#ifdef LS_SHADOW
+const bool has_shadow = true;
+#else
+const bool has_shadow = false;
+#endif
+
+uniform highp mat4 modelViewProjectionMatrix;
+
+uniform vec4 modulation;
+uniform float saturation;
+
+in highp vec2 texcoord0;
+out vec4 fragColor;
+
+#ifdef LS_SQUIRCLE
+// (1 + x)^(1/ratio) and its slope at 256 points of [0, 1], each with
+// 16 bits in two channels, see LSShader
+uniform highp sampler2D squircle_root;
+
+// t^ratio by multiplication
+highp float squirclePower(highp float t)
+{
+    highp float result = 1.0;
+    highp float t2 = t * t;
+    highp float t4 = t2 * t2;
+#if LS_SQUIRCLE_RATIO % 2 == 1
+    result *= t;
+#endif
+#if (LS_SQUIRCLE_RATIO / 2) % 2 == 1
+    result *= t2;
+#endif
+#if (LS_SQUIRCLE_RATIO / 4) % 2 == 1
+    result *= t4;
+#endif
+#if LS_SQUIRCLE_RATIO >= 8
+    result *= t4 * t4;
+#endif
+    return result;
+}
+#endif
+
+// Distance of p from the corner center, with p relative to that center
+// and pointing away from the window
+highp float cornerDistance(highp vec2 p)
+{
+#ifdef LS_SQUIRCLE
+    // The superellipse norm written as max * (1 + (min/max)^ratio)^(1/ratio),
+    // which only needs the root on [1, 2]
+    highp float large = max(p.x, p.y);
+    highp float x = squirclePower(min(p.x, p.y) / large);
+
+    // Continued from the nearest point along its slope
+    highp float i = floor(x * 255.0 + 0.5);
+    highp vec4 root = texture(squircle_root, vec2((i + 0.5) / 256.0, 0.5));
+    highp float value = 1.0 + (root.r + root.g / 255.0) * 0.41421356;
+    highp float slope = (root.b + root.a / 255.0) * 0.5;
+    return large * (value + slope * (x - i / 255.0));
+#else
+    return length(p);
+#endif
+}
+
+// How much of the pixel at distance dist lies inside clip_radius
+float coverage(highp float dist, highp float clip_radius)
+{
+    return clamp(clip_radius - dist + 0.5, 0.0, 1.0);
+}
+
+vec4 drawOutline(vec4 color, vec4 outline_color, float alpha)
+{
+    return mix(color, vec4(outline_color.rgb, 1.0), alpha * outline_color.a);
+}
+
+// Outlines across a straight frame edge, edge is the distance inside of
+// the frame
+vec4 shapeEdge(vec4 color, highp float edge)
+{
+    if(has_shadow) {
+        if(draw_inner_outline && edge >= 0.0 && edge <= inner_outline_width) {
+            color = drawOutline(color, inner_outline_color, 1.0);
+        }
+        if(draw_outer_outline && edge >= -outer_outline_width && edge <= 0.0) {
+            color = drawOutline(color, outer_outline_color, 1.0);
+        }
+    } else {
+        if(draw_inner_outline && edge >= outer_outline_width && edge <= outer_outline_width + inner_outline_width) {
+            color = drawOutline(color, inner_outline_color, 1.0);
+        }
+        if(draw_outer_outline && edge >= 0.0 && edge <= outer_outline_width) {
+            color = drawOutline(color, outer_outline_color, 1.0);
+        }
+    }
+    return color;
+}
+
+void main(void)
+{
+    // The frame as a rounded rectangle, p is relative to its center and
+    // edge the distance inside of its nearest edges, negative outside
+    highp vec2 coord0 = texcoord0 * expanded_size;
+    highp vec2 frame_origin = has_shadow ? shadow_size.xz : vec2(0.0);
+    highp vec2 half_size = frame_size * 0.5;
+    highp vec2 p = coord0 - frame_origin - half_size;
+    highp vec2 edge = half_size - abs(p);
+    highp vec2 corner = radius - edge;
+
+    // Where the shadow around the frame is sampled
+    highp float shadow_reach = max(shadow_sample_offset, outer_outline_width);
+    highp vec2 shadow_start = (frame_origin + half_size + sign(p) * (half_size + shadow_sample_offset)) / expanded_size;
+
+#ifdef LS_BAKE_SHADOW
+    // The shadow behind a corner continued from both edges next to it
+    fragColor = texture(sampler, vec2(texcoord0.x, shadow_start.y))
+               + texture(sampler, vec2(shadow_start.x, texcoord0.y))
+               - texture(sampler, shadow_start);
+    return;
+#endif
+
+    // The shadow next to the straight frame edges is moved out by the
+    // sample offset, those pixels read it instead of the window
+    highp vec2 sample_coord = texcoord0;
+    if(has_shadow) {
+        if(corner.x > 0.0 && corner.y < 0.0 && edge.x > -shadow_sample_offset && edge.x <= 0.0) {
+            sample_coord.x = shadow_start.x;
+        } else if(corner.x < 0.0 && edge.y > -shadow_sample_offset && edge.y <= 0.0) {
+            sample_coord.y = shadow_start.y;
+        }
+    }
+    vec4 tex = texture(sampler, sample_coord);
+    vec4 outColor = tex;
+
+    //Corners
+    if(corner.x > 0.0 && corner.y > 0.0) {
+        if(!has_shadow || (edge.x > -shadow_reach && edge.y > -shadow_reach)) {
+            highp float dist = cornerDistance(corner);
+            float alpha = coverage(dist, radius);
+            vec4 shaped = vec4(tex.rgb*alpha, min(alpha, tex.a));
+
+            if(has_shadow) {
+                highp vec2 quadrant = step(0.0, p);
+                highp vec2 tile_coord = coord0 - mix(shadow_tile_origins.xz, shadow_tile_origins.yw, quadrant) + quadrant * shadow_tile;
+                vec4 texShadow = texture(shadow_tiles, tile_coord / (2.0 * shadow_tile));
+                if(alpha == 0.0) {
+                    outColor = texShadow;
+                } else if(alpha < 1.0) {
+                    outColor = mix(shaped, texShadow, 1.0-alpha);
+                }
+            } else {
+                outColor = shaped;
+            }
+
+            // Without a shadow the outer outline is drawn inside the frame
+            highp float outer_edge = has_shadow ? radius + outer_outline_width : radius;
+            highp float inner_edge = outer_edge - outer_outline_width;
+            float inner_coverage = coverage(dist, inner_edge);
+            if(draw_inner_outline) {
+                outColor = drawOutline(outColor, inner_outline_color, inner_coverage - coverage(dist, inner_edge - inner_outline_width));
+            }
+            if(draw_outer_outline) {
+                outColor = drawOutline(outColor, outer_outline_color, coverage(dist, outer_edge) - inner_coverage);
+            }
+        }
+    //Left and right edge
+    } else if(corner.x > 0.0) {
+        if(corner.y < 0.0 && (!has_shadow || edge.x > -shadow_reach)) {
+            outColor = shapeEdge(outColor, edge.x);
+        }
+    //Top and bottom edge
+    } else if(corner.x < 0.0) {
+        outColor = shapeEdge(outColor, edge.y);
+    }
+
+    //Support opacity
+    if (saturation != 1.0) {
+        vec3 desaturated = outColor.rgb * vec3( 0.30, 0.59, 0.11 );
+        desaturated = vec3( dot( desaturated, outColor.rgb ));
+        outColor.rgb = outColor.rgb * vec3( saturation ) + desaturated * vec3( 1.0 - saturation );
+    }
+    outColor *= modulation;
+
+    //Output result
+    fragColor = outColor;
+}
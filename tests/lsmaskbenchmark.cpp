@@ -0,0 +1,201 @@
+/*
+ * Compares how fast LSHelper builds the corner mask regions against the
+ * QPainter path it replaced, which rasterized the corner shape into an
+ * image and traced the image into a region.
+ */
+
+#include "lshelper.h"
+
+#include <QBitmap>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QtMath>
+#include <QtTest>
+
+using namespace KWin;
+
+// The defaults of the configuration
+static const int s_shadowOffset = 2;
+static const int s_squircleRatio = 5;
+
+template <typename T> int signum(T val) {
+    return (T(0) < val) - (val < T(0));
+}
+
+/*
+ * The replaced path, as LSHelper::setMaskRegions() used to run it
+ */
+
+static QPainterPath
+rasterSuperellipse(float size, int n, int translate)
+{
+    float n2 = 2.0 / n;
+
+    int steps = 360;
+
+    float step = (2 * M_PI) / steps;
+
+    QPainterPath path;
+    path.moveTo(2*size, size);
+
+    for (int i = 1; i < steps; ++i)
+    {
+        float t = i * step;
+
+        float cosT = qCos(t);
+        float sinT = qSin(t);
+
+        float x = size + (qPow(qAbs(cosT), n2) * size * signum(cosT));
+        float y = size - (qPow(qAbs(sinT), n2) * size * signum(sinT));
+
+        path.lineTo(x, y);
+    }
+    path.lineTo(2*size, size);
+
+    path.translate(translate,translate);
+
+    return path;
+}
+
+static QImage
+rasterMaskImg(int size, int cornersType)
+{
+    QImage img(size*2, size*2, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    QRect r(img.rect());
+
+    p.fillRect(img.rect(), Qt::black);
+    p.setCompositionMode(QPainter::CompositionMode_DestinationOut);
+    p.setPen(Qt::NoPen);
+    p.setBrush(Qt::black);
+    p.setRenderHint(QPainter::Antialiasing);
+    if (cornersType == LSHelper::SquircledCorners) {
+        const QPainterPath squircle = rasterSuperellipse((size-s_shadowOffset), s_squircleRatio, s_shadowOffset);
+        p.drawPolygon(squircle.toFillPolygon());
+    } else {
+        p.drawEllipse(r.adjusted(s_shadowOffset,s_shadowOffset,-s_shadowOffset,-s_shadowOffset));
+    }
+    p.end();
+
+    return img;
+}
+
+static QRegion
+rasterMaskRegion(const QImage &img, int size, int corner)
+{
+    QImage img_copy;
+
+    switch(corner) {
+        case LSHelper::TopLeft:
+            img_copy = img.copy(0, 0, size, size);
+            break;
+        case LSHelper::TopRight:
+            img_copy = img.copy(size, 0, size, size);
+            break;
+        case LSHelper::BottomRight:
+            img_copy = img.copy(size, size, size, size);
+            break;
+        case LSHelper::BottomLeft:
+            img_copy = img.copy(0, size, size, size);
+            break;
+    }
+
+    img_copy = img_copy.createMaskFromColor(QColor(Qt::black).rgb(), Qt::MaskOutColor);
+    QBitmap bitmap = QBitmap::fromImage(img_copy, Qt::DiffuseAlphaDither);
+
+    return QRegion(bitmap);
+}
+
+static int
+regionArea(const QRegion &region)
+{
+    int area = 0;
+    for (const QRect &rect : region) {
+        area += rect.width() * rect.height();
+    }
+    return area;
+}
+
+class LSMaskBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void raster_data();
+    void raster();
+    void analytic_data();
+    void analytic();
+};
+
+static void
+addRadii()
+{
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<int>("cornersType");
+
+    for (int radius = 1; radius <= 64; ++radius) {
+        QTest::addRow("rounded %d", radius) << radius << int(LSHelper::RoundedCorners);
+        QTest::addRow("squircled %d", radius) << radius << int(LSHelper::SquircledCorners);
+    }
+}
+
+void
+LSMaskBenchmark::raster_data()
+{
+    addRadii();
+}
+
+void
+LSMaskBenchmark::raster()
+{
+    QFETCH(int, radius);
+    QFETCH(int, cornersType);
+
+    const int size = radius + s_shadowOffset;
+    QRegion regions[LSHelper::NTex];
+
+    QBENCHMARK {
+        const QImage img = rasterMaskImg(size, cornersType);
+        for (int corner = 0; corner < LSHelper::NTex; ++corner) {
+            regions[corner] = rasterMaskRegion(img, size, corner);
+        }
+    }
+
+    QVERIFY(regionArea(regions[LSHelper::TopLeft]) >= s_shadowOffset * (2 * size - s_shadowOffset));
+}
+
+void
+LSMaskBenchmark::analytic_data()
+{
+    addRadii();
+}
+
+void
+LSMaskBenchmark::analytic()
+{
+    QFETCH(int, radius);
+    QFETCH(int, cornersType);
+
+    const int size = radius + s_shadowOffset;
+    QRegion regions[LSHelper::NTex];
+
+    QBENCHMARK {
+        const QVector<int> spans = LSHelper::cornerSpans(size, radius, cornersType, s_squircleRatio);
+        for (int corner = 0; corner < LSHelper::NTex; ++corner) {
+            regions[corner] = LSHelper::createMaskRegion(spans, size, corner);
+        }
+    }
+
+    // Both paths mask the same corner, apart from the pixels on the curve
+    const QImage img = rasterMaskImg(size, cornersType);
+    for (int corner = 0; corner < LSHelper::NTex; ++corner) {
+        const QRegion raster = rasterMaskRegion(img, size, corner);
+        QVERIFY(regionArea(regions[corner].xored(raster)) <= size);
+    }
+}
+
+QTEST_MAIN(LSMaskBenchmark)
+
+#include "lsmaskbenchmark.moc"
@@ -0,0 +1,541 @@
+/*
+ * Renders two versions of the corner shader with EGL on a surfaceless Mesa
+ * display and compares them pixel by pixel. Every permutation of LSShader
+ * is drawn at scales 1, 1.5 and 2, radii of 3, 8 and 15 and outline
+ * widths of 1 to 3, over a window texture of noise with a shadow around
+ * it. Squircles run through ratios 2 to 12. Shadowed corners are baked
+ * into tiles first, as LightlyShadersEffect::bakeShadowTiles() does.
+ *
+ *     lsshaderparity legacy|core|gles reference.frag shader.frag
+ *                    [--tolerance n] [--bench]
+ *
+ * Exits with 1 if any channel differs by more than n/255, 1 by default.
+ * Corners where an outline band reaches the corner center are reported
+ * but not counted, the circle test of the old shaders covered those fully.
+ * With --bench every draw is repeated 200 times and both shaders are
+ * timed.
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum Variant {
+    Squircle = 1,
+    InnerOutline = 2,
+    OuterOutline = 4,
+    Shadow = 8,
+    BakeShadow = 16,
+    NVariants = 16
+};
+
+enum Mode {
+    Legacy,
+    Core,
+    Gles
+};
+
+struct Params {
+    float scale;
+    float radius;
+    float shadowOffset;
+    float innerWidth;
+    float outerWidth;
+    int ratio;
+    unsigned variant;
+    float modulation = 1.0;
+    float saturation = 1.0;
+};
+
+// Where the window lies in the expanded geometry, in device pixels, and
+// the sizes of its texture and of the viewport
+struct Geometry {
+    int textureWidth;
+    int textureHeight;
+    int width;
+    int height;
+    float expandedWidth;
+    float expandedHeight;
+    float frameX;
+    float frameY;
+    float frameWidth;
+    float frameHeight;
+};
+
+struct Tiles {
+    float size = 0;
+    float origins[4] = {0, 0, 0, 0};
+};
+
+static Mode s_mode = Core;
+
+static std::string
+readFile(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::perror(path);
+        std::exit(2);
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+static void
+replaceAll(std::string &source, const std::string &from, const std::string &to)
+{
+    for (size_t pos = source.find(from); pos != std::string::npos; pos = source.find(from, pos + to.size())) {
+        source.replace(pos, from.size(), to);
+    }
+}
+
+static GLuint
+compile(GLenum type, const std::string &source)
+{
+    const char *data = source.c_str();
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &data, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[4096];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "compile: %s\n", log);
+        std::exit(2);
+    }
+    return shader;
+}
+
+// The permutation as LSShader compiles it, with the quad drawn over the
+// expanded geometry, or over a source rectangle when baking
+static GLuint
+program(std::string fragment, unsigned variant, int ratio)
+{
+    if (s_mode == Gles && fragment.compare(0, 12, "#version 140") == 0) {
+        // What GLShader does on GLES 3, plus texture2D() which it lacks
+        replaceAll(fragment, "#version 140", "#version 300 es\n\nprecision highp float;\n");
+        replaceAll(fragment, "texture2D(", "texture(");
+    }
+
+    std::string defines;
+    if (variant & Squircle) {
+        defines += "#define LS_SQUIRCLE\n#define LS_SQUIRCLE_RATIO " + std::to_string(ratio) + "\n";
+    }
+    if (variant & InnerOutline) {
+        defines += "#define LS_INNER_OUTLINE\n";
+    }
+    if (variant & OuterOutline) {
+        defines += "#define LS_OUTER_OUTLINE\n";
+    }
+    if (variant & Shadow) {
+        defines += "#define LS_SHADOW\n";
+    }
+    if (variant & BakeShadow) {
+        defines += "#define LS_BAKE_SHADOW\n";
+    }
+    fragment.insert(fragment.find('\n') + 1, defines);
+
+    std::string vertex = s_mode == Legacy
+        ? "#version 110\nattribute vec2 position;\nvarying vec2 texcoord0;\n"
+        : "#version 140\nin vec2 position;\nout vec2 texcoord0;\n";
+    vertex += "uniform vec4 quad;\n"
+              "uniform vec4 src;\n"
+              "void main()\n"
+              "{\n"
+              "    vec2 corner = position * 0.5 + 0.5;\n"
+              "    texcoord0 = mix(src.xy, src.zw, corner);\n"
+              "    gl_Position = vec4(mix(quad.xy, quad.zw, corner), 0.0, 1.0);\n"
+              "}\n";
+    if (s_mode == Gles) {
+        replaceAll(vertex, "#version 140", "#version 300 es");
+    }
+
+    GLuint program = glCreateProgram();
+    GLuint shaders[2] = {compile(GL_VERTEX_SHADER, vertex), compile(GL_FRAGMENT_SHADER, fragment)};
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glBindAttribLocation(program, 0, "position");
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[4096];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "link: %s\n", log);
+        std::exit(2);
+    }
+    return program;
+}
+
+static void
+setUniforms(GLuint program, const Params &params, const Geometry &geo, const Tiles &tiles)
+{
+    const float s = params.scale;
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "sampler"), 0);
+    glUniform1i(glGetUniformLocation(program, "squircle_root"), 1);
+    glUniform1i(glGetUniformLocation(program, "shadow_tiles"), 2);
+    glUniform1f(glGetUniformLocation(program, "shadow_tile"), tiles.size);
+    glUniform4fv(glGetUniformLocation(program, "shadow_tile_origins"), 1, tiles.origins);
+    glUniform2f(glGetUniformLocation(program, "expanded_size"), geo.expandedWidth, geo.expandedHeight);
+    glUniform2f(glGetUniformLocation(program, "frame_size"), geo.frameWidth, geo.frameHeight);
+    glUniform3f(glGetUniformLocation(program, "shadow_size"), geo.frameX, geo.frameY, geo.expandedHeight - geo.frameHeight - geo.frameY);
+    glUniform1f(glGetUniformLocation(program, "radius"), params.radius * s);
+    glUniform1f(glGetUniformLocation(program, "shadow_sample_offset"), params.shadowOffset * s);
+    glUniform1f(glGetUniformLocation(program, "inner_outline_width"), params.innerWidth * s);
+    glUniform1f(glGetUniformLocation(program, "outer_outline_width"), params.outerWidth * s);
+    glUniform4f(glGetUniformLocation(program, "inner_outline_color"), 1.0, 1.0, 1.0, 0.3);
+    glUniform4f(glGetUniformLocation(program, "outer_outline_color"), 0.0, 0.0, 0.0, 0.8);
+    glUniform4f(glGetUniformLocation(program, "modulation"), params.modulation, params.modulation, params.modulation, params.modulation);
+    glUniform1f(glGetUniformLocation(program, "saturation"), params.saturation);
+    glUniform4f(glGetUniformLocation(program, "src"), 0.0, 0.0, 1.0, 1.0);
+
+    // The runtime switches of the reference shaders
+    glUniform1i(glGetUniformLocation(program, "is_squircle"), (params.variant & Squircle) != 0);
+    glUniform1i(glGetUniformLocation(program, "squircle_ratio"), params.ratio);
+    glUniform1i(glGetUniformLocation(program, "draw_inner_outline"), (params.variant & InnerOutline) != 0);
+    glUniform1i(glGetUniformLocation(program, "draw_outer_outline"), (params.variant & OuterOutline) != 0);
+}
+
+// Splits a value in [0, 1] over two bytes, like LSShader
+static void
+encode(unsigned char *texel, double value)
+{
+    const double scaled = std::clamp(value, 0.0, 1.0) * 255.0;
+    const int high = std::min(int(scaled), 255);
+    texel[0] = high;
+    texel[1] = std::clamp(int(std::lround((scaled - high) * 255.0)), 0, 255);
+}
+
+static GLuint
+texture(int width, int height, const unsigned char *texels, GLint filter)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// LSShader::updateSquircleRoot()
+static GLuint
+squircleRoot(int ratio)
+{
+    const int size = 256;
+    std::vector<unsigned char> texels(size * 4);
+    const double n = ratio;
+    for (int i = 0; i < size; ++i) {
+        const double x = 1.0 + double(i) / (size - 1);
+        encode(texels.data() + i * 4, (std::pow(x, 1.0 / n) - 1.0) / (M_SQRT2 - 1.0));
+        encode(texels.data() + i * 4 + 2, std::pow(x, 1.0 / n - 1.0) / n / 0.5);
+    }
+    return texture(size, 1, texels.data(), GL_NEAREST);
+}
+
+// Opaque noise inside the frame, a noisy shadow outside of it
+static GLuint
+windowTexture(const Geometry &geo, unsigned seed)
+{
+    std::vector<unsigned char> texels(geo.textureWidth * geo.textureHeight * 4);
+    const float bottom = geo.expandedHeight - geo.frameY - geo.frameHeight;
+    for (int y = 0; y < geo.textureHeight; ++y) {
+        for (int x = 0; x < geo.textureWidth; ++x) {
+            unsigned char *t = texels.data() + (y * geo.textureWidth + x) * 4;
+            const float cx = (x + 0.5f) * geo.expandedWidth / geo.textureWidth;
+            const float cy = (y + 0.5f) * geo.expandedHeight / geo.textureHeight;
+            const bool inside = cx >= geo.frameX && cx <= geo.frameX + geo.frameWidth
+                && cy >= bottom && cy <= bottom + geo.frameHeight;
+            seed = seed * 1103515245 + 12345;
+            if (inside) {
+                t[0] = seed >> 24;
+                t[1] = seed >> 16;
+                t[2] = seed >> 8;
+                t[3] = 255;
+            } else {
+                t[0] = t[1] = t[2] = 0;
+                t[3] = 40 + (seed >> 27);
+            }
+        }
+    }
+    return texture(geo.textureWidth, geo.textureHeight, texels.data(), GL_LINEAR);
+}
+
+/*
+ * The corner squares of the shadow in one texture, as the effect bakes
+ * them. The origins are whole pixels from the texture origin, see
+ * shadowTileOrigins() in lightlyshaders.cpp.
+ */
+static GLuint
+bakeTiles(const std::string &source, const Params &params, const Geometry &geo, Tiles &tiles)
+{
+    const float s = params.scale;
+    const float radius = params.radius * s;
+    const int size = int(std::ceil(radius + std::max(params.shadowOffset * s, params.outerWidth * s))) + 1;
+    const float bottom = geo.expandedHeight - geo.frameHeight - geo.frameY;
+    tiles.size = size;
+    tiles.origins[0] = std::ceil(geo.frameX + radius) - size;
+    tiles.origins[1] = std::floor(geo.frameX + geo.frameWidth - radius);
+    tiles.origins[2] = std::ceil(bottom + radius) - size;
+    tiles.origins[3] = std::floor(bottom + geo.frameHeight - radius);
+
+    glActiveTexture(GL_TEXTURE2);
+    GLuint result = texture(2 * size, 2 * size, nullptr, GL_LINEAR);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, result, 0);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    GLuint bake = program(source, Shadow | BakeShadow, params.ratio);
+    setUniforms(bake, params, geo, tiles);
+    glUniform4f(glGetUniformLocation(bake, "quad"), -1.0, -1.0, 1.0, 1.0);
+    for (int corner = 0; corner < 4; ++corner) {
+        const int right = corner & 1;
+        const int upper = corner >> 1;
+        const float x = tiles.origins[right];
+        const float y = tiles.origins[2 + upper];
+        glUniform4f(glGetUniformLocation(bake, "src"), x / geo.expandedWidth, y / geo.expandedHeight,
+                    (x + size) / geo.expandedWidth, (y + size) / geo.expandedHeight);
+        glViewport(right * size, upper * size, size, size);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    glDeleteProgram(bake);
+    glDeleteFramebuffers(1, &fbo);
+    return result;
+}
+
+/*
+ * Draws the shader over the expanded geometry, which is as large in device
+ * pixels as KWin draws it, with the texture stretched over it. A shadowed
+ * window's quad starts on a whole pixel, as the offscreen effect puts it,
+ * so the shadow tiles are read 1:1. Without a shadow it is moved by a
+ * quarter pixel. That keeps frame edges and outline bands off the pixel
+ * centers, where both shaders may round either way.
+ */
+static std::vector<unsigned char>
+render(GLuint program, const Params &params, const Geometry &geo, const Tiles &tiles, int iterations, double *ms)
+{
+    setUniforms(program, params, geo, tiles);
+    const float offsetX = (params.variant & Shadow) ? 0.0 : 0.5 / geo.width;
+    const float offsetY = (params.variant & Shadow) ? 0.0 : 0.5 / geo.height;
+    glUniform4f(glGetUniformLocation(program, "quad"), -1.0 + offsetX, -1.0 + offsetY,
+                2.0 * geo.expandedWidth / geo.width - 1.0 + offsetX,
+                2.0 * geo.expandedHeight / geo.height - 1.0 + offsetY);
+    glViewport(0, 0, geo.width, geo.height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glFinish();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    glFinish();
+    *ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<unsigned char> pixels(geo.width * geo.height * 4);
+    glReadPixels(0, 0, geo.width, geo.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// Whether an outline band reaches the corner center
+static bool
+degenerate(const Params &params)
+{
+    const bool inner = params.variant & InnerOutline;
+    const bool outer = params.variant & OuterOutline;
+    if (params.variant & Shadow) {
+        return inner && params.radius - params.innerWidth <= 0;
+    }
+    return (inner && params.radius - params.outerWidth - params.innerWidth <= 0)
+        || (outer && params.radius - params.outerWidth <= 0);
+}
+
+static bool
+initialize()
+{
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (!getPlatformDisplay) {
+        std::fprintf(stderr, "EGL_EXT_platform_base is missing\n");
+        return false;
+    }
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        std::fprintf(stderr, "No surfaceless EGL display\n");
+        return false;
+    }
+
+    eglBindAPI(s_mode == Gles ? EGL_OPENGL_ES_API : EGL_OPENGL_API);
+    const EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, s_mode == Gles ? 0 : 1,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::fprintf(stderr, "No EGL context\n");
+        return false;
+    }
+    std::printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 4) {
+        std::fprintf(stderr, "usage: %s legacy|core|gles reference.frag shader.frag [--tolerance n] [--bench]\n", argv[0]);
+        return 2;
+    }
+    s_mode = !std::strcmp(argv[1], "legacy") ? Legacy : !std::strcmp(argv[1], "gles") ? Gles : Core;
+    const std::string referenceSource = readFile(argv[2]);
+    const std::string source = readFile(argv[3]);
+    int tolerance = 1;
+    bool bench = false;
+    for (int i = 4; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            tolerance = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--bench")) {
+            bench = true;
+        }
+    }
+
+    if (!initialize()) {
+        return 2;
+    }
+
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    const float quad[] = {-1, -1, 1, -1, -1, 1, 1, 1};
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+
+    const float scales[] = {1.0, 1.5, 2.0};
+    const int radii[] = {3, 8, 15};
+    const int widths[] = {1, 2, 3};
+    int worst = 0;
+    long offChannels = 0;
+    int runs = 0;
+    double referenceMs = 0;
+    double shaderMs = 0;
+
+    for (int si = 0; si < 3; ++si)
+    for (int ri = 0; ri < 3; ++ri)
+    for (int wi = 0; wi < 3; ++wi)
+    for (unsigned variant = 0; variant < NVariants; ++variant) {
+        const float s = scales[si];
+        Params params = {s, float(radii[ri]), radii[ri] > 3 ? 3.0f : 2.0f, float(widths[wi]), float(widths[(wi + 1) % 3]),
+                         variant & Squircle ? 2 + (si * 9 + ri * 3 + wi) % 11 : 2, variant};
+        if (ri == 1 && wi == 2) {
+            params.modulation = 0.7;
+            params.saturation = 0.5;
+        }
+
+        // A 121x77 window, with a shadow of 15, 17, 9 and 21 logical
+        // pixels left, right, top and bottom. The frame is a quarter pixel
+        // off the pixel grid, for the same reason as in render().
+        Geometry geo;
+        const bool shadow = variant & Shadow;
+        geo.frameWidth = 121 * s;
+        geo.frameHeight = 77 * s;
+        geo.frameX = shadow ? 15 * s + 0.25f : 0;
+        geo.frameY = shadow ? 9 * s + 0.25f : 0;
+        geo.expandedWidth = shadow ? (121 + 15 + 17) * s : geo.frameWidth;
+        geo.expandedHeight = shadow ? (77 + 9 + 21) * s : geo.frameHeight;
+        // The offscreen effect rounds the texture size
+        geo.textureWidth = int(std::lround(geo.expandedWidth));
+        geo.textureHeight = int(std::lround(geo.expandedHeight));
+        geo.width = int(std::ceil(geo.expandedWidth)) + 1;
+        geo.height = int(std::ceil(geo.expandedHeight)) + 1;
+
+        GLuint fboTexture = texture(geo.width, geo.height, nullptr, GL_NEAREST);
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+
+        glActiveTexture(GL_TEXTURE1);
+        GLuint root = squircleRoot(params.ratio);
+        glActiveTexture(GL_TEXTURE0);
+        GLuint window = windowTexture(geo, 12345 + variant);
+
+        Tiles tiles;
+        GLuint tilesTexture = shadow ? bakeTiles(source, params, geo, tiles) : 0;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fboTexture, 0);
+        glBindTexture(GL_TEXTURE_2D, window);
+
+        GLuint referenceProgram = program(referenceSource, variant, params.ratio);
+        GLuint shaderProgram = program(source, variant, params.ratio);
+        const int iterations = bench ? 200 : 1;
+        double a, b;
+        const std::vector<unsigned char> expected = render(referenceProgram, params, geo, tiles, iterations, &a);
+        const std::vector<unsigned char> actual = render(shaderProgram, params, geo, tiles, iterations, &b);
+        referenceMs += a;
+        shaderMs += b;
+
+        int diff = 0;
+        int at = 0;
+        long off = 0;
+        for (size_t i = 0; i < actual.size(); ++i) {
+            const int d = std::abs(expected[i] - actual[i]);
+            off += d > tolerance;
+            if (d > diff) {
+                diff = d;
+                at = i / 4;
+            }
+        }
+        const bool skipped = degenerate(params);
+        if (diff > tolerance) {
+            std::printf("scale %.1f radius %d widths %g/%g variant %u: %d/255 at %d,%d%s\n", s, radii[ri],
+                        params.innerWidth, params.outerWidth, variant, diff, at % geo.width, at / geo.width,
+                        skipped ? ", band reaches the corner center" : "");
+        }
+        if (!skipped) {
+            worst = std::max(worst, diff);
+            offChannels += off;
+        }
+        ++runs;
+
+        glDeleteProgram(referenceProgram);
+        glDeleteProgram(shaderProgram);
+        GLuint textures[] = {fboTexture, root, window, tilesTexture};
+        glDeleteTextures(shadow ? 4 : 3, textures);
+        glDeleteFramebuffers(1, &fbo);
+    }
+
+    std::printf("%d runs, worst difference %d/255, %ld channels off by more than %d\n", runs, worst, offChannels, tolerance);
+    if (bench) {
+        std::printf("reference %.1f ms, shader %.1f ms\n", referenceMs, shaderMs);
+    }
+    return worst > tolerance ? 1 : 0;
+}